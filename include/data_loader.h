@@ -2,6 +2,7 @@
 #define DATA_LOADER_H
 
 #include "data_types.h"
+#include "table_reader.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -11,13 +12,16 @@
 
 class DataLoader {
 public:
-    // Load data from TPCH files
-    static std::vector<Customer> loadCustomers(const std::string& filePath);
-    static std::vector<Order> loadOrders(const std::string& filePath, const Date& dateFrom, const Date& dateTo);
-    static std::vector<LineItem> loadLineItems(const std::string& filePath);
-    static std::vector<Supplier> loadSuppliers(const std::string& filePath);
-    static std::vector<Nation> loadNations(const std::string& filePath);
-    static std::vector<Region> loadRegions(const std::string& filePath, const std::string& regionName);
+    // Load data from TPCH files (plain, .gz or .zst)
+    static CustomerTable loadCustomers(const std::string& filePath);
+    static OrderTable loadOrders(const std::string& filePath, const Date& dateFrom, const Date& dateTo);
+    static LineItemTable loadLineItems(const std::string& filePath);
+    static SupplierTable loadSuppliers(const std::string& filePath);
+    static NationTable loadNations(const std::string& filePath);
+    static RegionTable loadRegions(const std::string& filePath, const std::string& regionName);
+    
+    // Load batch query parameters, one "region,date-from,date-to" per line
+    static std::vector<QueryParameters> loadQueryBatch(const std::string& filePath);
     
 private:
     // Helper function to split a string by delimiter
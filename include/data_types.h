@@ -5,6 +5,8 @@
 #include <vector>
 #include <unordered_map>
 #include <cstdint>
+#include <cstdio>
+#include "memory_tracker.h"
 
 // Date structure for efficient date comparison
 struct Date {
@@ -27,6 +29,13 @@ struct Date {
         return date;
     }
     
+    // Format date as YYYY-MM-DD
+    std::string toString() const {
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, month, day);
+        return buffer;
+    }
+    
     // Compare dates
     bool operator<(const Date& other) const {
         if (year != other.year) return year < other.year;
@@ -108,6 +117,25 @@ struct Region {
     Region(int32_t regionkey, const std::string& name) : r_regionkey(regionkey), r_name(name) {}
 };
 
+// Tables are stored in tracked vectors so their memory shows up per structure
+using CustomerTable = TrackedVector<Customer, MemoryCategory::Customers>;
+using OrderTable = TrackedVector<Order, MemoryCategory::Orders>;
+using LineItemTable = TrackedVector<LineItem, MemoryCategory::LineItems>;
+using SupplierTable = TrackedVector<Supplier, MemoryCategory::Suppliers>;
+using NationTable = TrackedVector<Nation, MemoryCategory::Nations>;
+using RegionTable = TrackedVector<Region, MemoryCategory::Regions>;
+
+// Parameters of a single Query 5 evaluation
+struct QueryParameters {
+    std::string regionName;
+    Date dateFrom;
+    Date dateTo;
+    
+    QueryParameters() {}
+    QueryParameters(const std::string& region, const Date& from, const Date& to)
+        : regionName(region), dateFrom(from), dateTo(to) {}
+};
+
 // Result structure
 struct QueryResult {
     std::string nation;
@@ -121,4 +149,20 @@ struct QueryResult {
     }
 };
 
+// Approximate result with a confidence interval for the revenue
+struct ApproxQueryResult {
+    std::string nation;
+    double revenue;
+    double ciLower;
+    double ciUpper;
+    
+    ApproxQueryResult() : revenue(0.0), ciLower(0.0), ciUpper(0.0) {}
+    ApproxQueryResult(const std::string& n, double r, double lower, double upper)
+        : nation(n), revenue(r), ciLower(lower), ciUpper(upper) {}
+    
+    bool operator<(const ApproxQueryResult& other) const {
+        return revenue > other.revenue; // For descending order
+    }
+};
+
 #endif // DATA_TYPES_H
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef INDEX_SNAPSHOT_H
+#define INDEX_SNAPSHOT_H
+
+#include "data_types.h"
+#include "query_processor.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk copy of the join indexes of one Query 5 parameter set.
+// Sections are addressed by file offset, so a snapshot is mapped and used
+// in place without deserializing. A fingerprint of the build-side input
+// files and query parameters rejects stale snapshots, and a checksum
+// rejects corrupt ones.
+class IndexSnapshot {
+public:
+    IndexSnapshot();
+
+    // Unmap the snapshot; its indexes must no longer be used
+    ~IndexSnapshot();
+
+    IndexSnapshot(const IndexSnapshot&) = delete;
+    IndexSnapshot& operator=(const IndexSnapshot&) = delete;
+
+    // Fingerprint of the source files (path, size and modification time)
+    // and of the query parameters the indexes are built for
+    static uint64_t fingerprint(
+        const std::vector<std::string>& sourcePaths,
+        const std::string& regionName,
+        const Date& dateFrom,
+        const Date& dateTo
+    );
+
+    // Write indexes to filePath; returns false on failure
+    static bool save(const std::string& filePath, uint64_t fingerprint, const JoinIndexes& indexes);
+
+    // Map a snapshot and validate it. Returns false if the file is missing,
+    // stale or corrupt.
+    bool open(const std::string& filePath, uint64_t fingerprint);
+
+    // Join indexes viewing the mapped file; valid while the snapshot is open
+    const JoinIndexes& indexes() const;
+
+private:
+    // Reject the mapped file with a reason and unmap it
+    bool reject(const std::string& filePath, const std::string& reason);
+
+    void close();
+
+    void* mapping;
+    size_t mappingSize;
+    JoinIndexes views;
+};
+
+#endif // INDEX_SNAPSHOT_H
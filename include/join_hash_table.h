@@ -0,0 +1,111 @@
+#ifndef JOIN_HASH_TABLE_H
+#define JOIN_HASH_TABLE_H
+
+#include "memory_tracker.h"
+#include <cstdint>
+#include <cstddef>
+#include <climits>
+
+// Open-addressing hash table from int32 join keys to int32 payloads.
+// Slots live in one flat array so a probe's cache line can be prefetched
+// before it is needed.
+class JoinHashTable {
+public:
+    // Key marking an unused slot; never a valid TPCH key
+    static constexpr int32_t kEmptyKey = INT32_MIN;
+
+    struct Slot {
+        int32_t key;
+        int32_t value;
+    };
+
+    // Create an empty table that finds nothing
+    JoinHashTable();
+
+    // Create a table sized for expectedEntries, accounted to category
+    JoinHashTable(MemoryCategory category, size_t expectedEntries);
+
+    // Wrap read-only slots owned elsewhere, such as a mapped index snapshot.
+    // capacity must be a power of two and the slots must outlive the table.
+    JoinHashTable(const Slot* slots, size_t capacity, size_t entries);
+
+    ~JoinHashTable();
+
+    JoinHashTable(JoinHashTable&& other) noexcept;
+    JoinHashTable& operator=(JoinHashTable&& other) noexcept;
+    JoinHashTable(const JoinHashTable&) = delete;
+    JoinHashTable& operator=(const JoinHashTable&) = delete;
+
+    // Insert from several threads at once by claiming slots with CAS
+    // (kEmptyKey is ignored); not allowed on wrapped slots. A key already
+    // present keeps its value and false is returned; with several threads
+    // the copy that is kept depends on timing. Returns true if the key was
+    // inserted; the caller reports the total with commitConcurrentInserts
+    // once every thread has finished.
+    bool insertConcurrent(int32_t key, int32_t value);
+    void commitConcurrentInserts(size_t inserted);
+
+    // Find the payload of a key, or nullptr if absent
+    const int32_t* find(int32_t key) const {
+        if (capacity == 0) {
+            return nullptr;
+        }
+        for (size_t slot = slotFor(key);; slot = (slot + 1) & mask) {
+            if (slots[slot].key == key) {
+                return &slots[slot].value;
+            }
+            if (slots[slot].key == kEmptyKey) {
+                return nullptr;
+            }
+        }
+    }
+
+    // Bring the home slot of a key into cache ahead of a find
+    void prefetch(int32_t key) const {
+        if (capacity != 0) {
+            __builtin_prefetch(&slots[slotFor(key)]);
+        }
+    }
+
+    // Call f(key, value) for every entry
+    template<class F>
+    void forEach(F&& f) const {
+        forEachInSlots(0, capacity, f);
+    }
+
+    // Call f(key, value) for every entry in slots [first, last), so
+    // disjoint slot ranges can be visited by different threads
+    template<class F>
+    void forEachInSlots(size_t first, size_t last, F&& f) const {
+        for (size_t slot = first; slot < last; ++slot) {
+            if (slots[slot].key != kEmptyKey) {
+                f(slots[slot].key, slots[slot].value);
+            }
+        }
+    }
+
+    // Number of entries
+    size_t size() const;
+
+    // Raw slot array and its length, for serialization
+    const Slot* data() const;
+    size_t slotCount() const;
+
+private:
+    size_t slotFor(int32_t key) const {
+        uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(key)) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(hash >> shift);
+    }
+
+    void release();
+
+    Slot* slots;
+    size_t capacity;
+    size_t mask;
+    unsigned shift;
+    size_t entries;
+    MemoryCategory category;
+    bool owned;
+};
+
+#endif // JOIN_HASH_TABLE_H
@@ -0,0 +1,142 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Structures whose memory is accounted separately
+enum class MemoryCategory {
+    Customers,
+    Orders,
+    LineItems,
+    Suppliers,
+    Nations,
+    Regions,
+    OrderIndex,
+    SupplierIndex,
+    CustomerIndex,
+    RuntimeFilters,
+    IndexSnapshot,
+    Count
+};
+
+// How large allocations are backed
+enum class HugePageMode {
+    Off,            // Regular heap allocations
+    Transparent,    // mmap + madvise(MADV_HUGEPAGE)
+    Explicit        // mmap with MAP_HUGETLB, falling back to Transparent
+};
+
+// Process-wide byte accounting per category with peak tracking per phase.
+// Huge page settings must be configured before the first tracked allocation.
+class MemoryTracker {
+public:
+    // Allocate and account bytes for a category. Only allocations with
+    // allowHugePages set may be backed by huge pages.
+    static void* allocate(MemoryCategory category, size_t bytes, bool allowHugePages = true);
+
+    // Release memory obtained from allocate with the same size and flag
+    static void deallocate(MemoryCategory category, void* pointer, size_t bytes, bool allowHugePages = true);
+
+    // Account memory obtained outside allocate, such as a file mapping
+    static void recordMapping(MemoryCategory category, size_t bytes);
+    static void releaseMapping(MemoryCategory category, size_t bytes);
+
+    // Back allocations of at least threshold bytes with huge pages; the
+    // threshold is raised to one huge page so small allocations never get
+    // a mapping of their own
+    static void configureHugePages(HugePageMode mode, size_t threshold);
+
+    // Start a named phase; the previous phase ends and keeps its peak
+    static void beginPhase(const std::string& name);
+
+    // Write per-structure and per-phase usage to a stream
+    static void report(std::ostream& out);
+
+    // Name of a category for reports
+    static const char* categoryName(MemoryCategory category);
+
+private:
+    struct PhaseUsage {
+        std::string name;
+        size_t peakBytes;
+        size_t endBytes;
+    };
+
+    static void recordAllocation(MemoryCategory category, size_t bytes);
+    static void recordDeallocation(MemoryCategory category, size_t bytes);
+    static void endPhase();
+
+    static constexpr size_t kNumCategories = static_cast<size_t>(MemoryCategory::Count);
+
+    static std::atomic<size_t> currentBytes[kNumCategories];
+    static std::atomic<size_t> peakBytes[kNumCategories];
+    static std::atomic<size_t> totalBytes;
+    static std::atomic<size_t> totalPeakBytes;
+    static std::atomic<size_t> phasePeakBytes;
+    static std::atomic<size_t> hugePageBytes;
+
+    static HugePageMode hugePageMode;
+    static size_t hugePageThreshold;
+
+    static std::mutex phaseMutex;
+    static std::string currentPhase;
+    static std::vector<PhaseUsage> phases;
+};
+
+// Standard allocator that accounts every allocation to a category.
+// HugePages lets large allocations use huge pages when they are enabled.
+template<class T, MemoryCategory Category, bool HugePages = true>
+class TrackingAllocator {
+public:
+    using value_type = T;
+
+    template<class U>
+    struct rebind {
+        using other = TrackingAllocator<U, Category, HugePages>;
+    };
+
+    TrackingAllocator() noexcept {}
+
+    template<class U>
+    TrackingAllocator(const TrackingAllocator<U, Category, HugePages>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > static_cast<size_t>(-1) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(MemoryTracker::allocate(Category, n * sizeof(T), HugePages));
+    }
+
+    void deallocate(T* pointer, size_t n) noexcept {
+        MemoryTracker::deallocate(Category, pointer, n * sizeof(T), HugePages);
+    }
+
+    template<class U>
+    bool operator==(const TrackingAllocator<U, Category, HugePages>&) const noexcept {
+        return true;
+    }
+
+    template<class U>
+    bool operator!=(const TrackingAllocator<U, Category, HugePages>&) const noexcept {
+        return false;
+    }
+};
+
+// Containers whose memory is accounted to a category
+template<class T, MemoryCategory Category>
+using TrackedVector = std::vector<T, TrackingAllocator<T, Category>>;
+
+// Node-based, so it stays on the heap even with huge pages enabled
+template<class K, class V, MemoryCategory Category>
+using TrackedHashMap = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>,
+                                          TrackingAllocator<std::pair<const K, V>, Category, false>>;
+
+#endif // MEMORY_TRACKER_H
@@ -2,57 +2,279 @@
 #define QUERY_PROCESSOR_H
 
 #include "data_types.h"
+#include "join_hash_table.h"
+#include "runtime_filter.h"
 #include "thread_pool.h"
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 
+// Join state built once per query and shared read-only by all scan workers
+struct JoinIndexes {
+    // Orders in the date range whose customer is in the region
+    JoinHashTable orderToCustomer;
+    // Suppliers located in the region
+    JoinHashTable supplierToNation;
+    // Customers located in the region
+    JoinHashTable customerToNation;
+
+    // Runtime filters over the lineitem foreign keys
+    RuntimeFilter supplierFilter;
+    RuntimeFilter orderFilter;
+
+    // Nation names by nation key
+    std::unordered_map<int32_t, std::string> nationNames;
+};
+
+// Kernels for probing the join indexes from lineitem
+enum class ProbeMode {
+    Plain,      // Resolve one row at a time
+    Prefetch    // Prefetch the slots of a group of rows, then resolve them
+};
+
+// Bitmask of the batch queries a row qualifies for, one bit per query
+using QueryMask = uint64_t;
+
+// Qualifying order in a batch: its customer's nation and the queries whose
+// date range contains it
+struct BatchOrderEntry {
+    int32_t customerNation;
+    QueryMask queries;
+};
+
+// Join state shared by every query of a batch
+struct BatchJoinIndexes {
+    // Qualifying orders, and the position of each in orderEntries by order key
+    TrackedVector<BatchOrderEntry, MemoryCategory::OrderIndex> orderEntries;
+    JoinHashTable orderToEntry;
+    JoinHashTable supplierToNation;
+
+    // Queries whose region contains each nation, indexed by nation key
+    std::vector<QueryMask> nationMasks;
+
+    RuntimeFilter supplierFilter;
+    RuntimeFilter orderFilter;
+};
+
+// Per-query, per-nation accumulators of a batch scan, indexed by
+// query * nationMasks.size() + nation key
+struct BatchAccumulators {
+    std::vector<double> revenues;
+    std::vector<uint64_t> matches;
+};
+
+// Sampling schemes for approximate queries
+enum class SamplingMethod {
+    Block,      // Random blocks of consecutive line items
+    Uniform     // Independent Bernoulli sample of line items
+};
+
+// Settings for approximate query processing
+struct ApproxOptions {
+    SamplingMethod method = SamplingMethod::Block;
+    // Maximum fraction of lineitem to sample
+    double sampleRate = 0.01;
+    // Stop once every interval half-width is within this fraction of its
+    // estimate; 0 samples exactly sampleRate
+    double targetError = 0.0;
+    double confidence = 0.95;
+    size_t blockSize = 16384;
+    uint64_t seed = 42;
+};
+
+// Outcome of an approximate query
+struct ApproxSummary {
+    std::vector<ApproxQueryResult> results;
+    size_t sampledRows = 0;
+    size_t rounds = 0;
+    bool converged = false;
+};
+
+// Sum and sum of squares of sampled revenue for one nation, with the
+// number of sampled units (rows or blocks) that hit it and the largest one
+struct SampleMoments {
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    size_t count = 0;
+    double maxValue = 0.0;
+};
+
+// Sample statistics collected by one worker
+struct SampleAccumulator {
+    std::unordered_map<int32_t, SampleMoments> nations;
+    size_t rows = 0;
+};
+
 class QueryProcessor {
 public:
     // Constructor
     QueryProcessor(size_t numThreads);
-    
+
     // Destructor
     ~QueryProcessor();
-    
+
+    // Select the probe kernel and the number of rows per prefetch group
+    void setProbeMode(ProbeMode mode, size_t groupSize);
+
     // Process TPCH Query 5
     std::vector<QueryResult> processQuery(
-        const std::vector<Customer>& customers,
-        const std::vector<Order>& orders,
-        const std::vector<LineItem>& lineItems,
-        const std::vector<Supplier>& suppliers,
-        const std::vector<Nation>& nations,
-        const std::vector<Region>& regions
-    );
-    
+        const CustomerTable& customers,
+        const OrderTable& orders,
+        const LineItemTable& lineItems,
+        const SupplierTable& suppliers,
+        const NationTable& nations,
+        const RegionTable& regions
+    );
+
+    // Process TPCH Query 5 against prebuilt join indexes
+    std::vector<QueryResult> processQuery(
+        const LineItemTable& lineItems,
+        const JoinIndexes& indexes
+    );
+
+    // Estimate TPCH Query 5 from a sample of lineitem. With a target error the
+    // sample grows geometrically until every interval is tight enough or the
+    // sample rate is reached.
+    ApproxSummary processApproxQuery(
+        const CustomerTable& customers,
+        const OrderTable& orders,
+        const LineItemTable& lineItems,
+        const SupplierTable& suppliers,
+        const NationTable& nations,
+        const RegionTable& regions,
+        const ApproxOptions& options
+    );
+
+    // Estimate TPCH Query 5 against prebuilt join indexes
+    ApproxSummary processApproxQuery(
+        const LineItemTable& lineItems,
+        const JoinIndexes& indexes,
+        const ApproxOptions& options
+    );
+
+    // Wall time of the last buildJoinIndexes call in milliseconds, or -1 if
+    // the indexes have not been built by this processor
+    int64_t lastBuildMilliseconds() const;
+
+    // Build the join indexes and nation names of a single query
+    JoinIndexes buildJoinIndexes(
+        const CustomerTable& customers,
+        const OrderTable& orders,
+        const SupplierTable& suppliers,
+        const NationTable& nations,
+        const RegionTable& regions
+    );
+
+    // Maximum number of queries evaluated by one shared scan
+    static constexpr size_t kMaxBatchQueries = 64;
+
+    // Process many Query 5 parameter sets with shared scans of lineitem.
+    // Regions must contain every region named in the batch and orders must
+    // cover the union of the date ranges. Returns one result list per query.
+    std::vector<std::vector<QueryResult>> processBatch(
+        const CustomerTable& customers,
+        const OrderTable& orders,
+        const LineItemTable& lineItems,
+        const SupplierTable& suppliers,
+        const NationTable& nations,
+        const RegionTable& regions,
+        const std::vector<QueryParameters>& queries
+    );
+
 private:
     // Thread pool for parallel processing
     ThreadPool threadPool;
-    
+
+    // Probe kernel used by the lineitem scans
+    ProbeMode probeMode;
+    size_t prefetchGroupSize;
+
+    // Wall time of the last buildJoinIndexes call
+    int64_t buildMilliseconds;
+
     // Process a chunk of line items
     std::unordered_map<int32_t, double> processChunk(
-        const std::vector<LineItem>& lineItems,
+        const LineItemTable& lineItems,
+        size_t start,
+        size_t end,
+        const JoinIndexes& indexes
+    );
+
+    // Process a chunk of line items for every query of a batch
+    BatchAccumulators processBatchChunk(
+        const LineItemTable& lineItems,
+        size_t start,
+        size_t end,
+        const BatchJoinIndexes& indexes,
+        size_t numQueries
+    );
+
+    // Sample whole blocks blockOrder[first, last) for an approximate query
+    SampleAccumulator sampleBlocks(
+        const LineItemTable& lineItems,
+        const std::vector<size_t>& blockOrder,
+        size_t first,
+        size_t last,
+        size_t blockSize,
+        const JoinIndexes& indexes
+    );
+
+    // Add every row of a chunk that is not yet in sampled (sorted offsets
+    // from start) with probability rate, and update sampled
+    SampleAccumulator sampleRows(
+        const LineItemTable& lineItems,
         size_t start,
         size_t end,
-        const std::unordered_map<int32_t, int32_t>& orderToCustomer,
-        const std::unordered_map<int32_t, int32_t>& supplierToNation,
-        const std::unordered_map<int32_t, bool>& validCustomerNations
+        double rate,
+        uint64_t seed,
+        std::vector<uint32_t>& sampled,
+        const JoinIndexes& indexes
+    );
+
+    // Evaluate up to kMaxBatchQueries queries with a single scan
+    std::vector<std::vector<QueryResult>> processBatchGroup(
+        const CustomerTable& customers,
+        const OrderTable& orders,
+        const LineItemTable& lineItems,
+        const SupplierTable& suppliers,
+        const NationTable& nations,
+        const RegionTable& regions,
+        const std::vector<QueryParameters>& queries
     );
-    
+
     // Build indexes for efficient joins
-    std::unordered_map<int32_t, int32_t> buildOrderToCustomerIndex(const std::vector<Order>& orders);
-    std::unordered_map<int32_t, int32_t> buildSupplierToNationIndex(const std::vector<Supplier>& suppliers);
-    std::unordered_map<int32_t, bool> buildValidCustomerNationsIndex(
-        const std::vector<Customer>& customers,
-        const std::vector<Supplier>& suppliers
-    );
-    std::unordered_map<int32_t, std::string> buildNationNameIndex(const std::vector<Nation>& nations);
-    
+    std::unordered_set<int32_t> buildRegionNationSet(
+        const NationTable& nations,
+        const RegionTable& regions
+    );
+    JoinHashTable buildSupplierToNationIndex(
+        const SupplierTable& suppliers,
+        const std::unordered_set<int32_t>& regionNations
+    );
+    JoinHashTable buildCustomerToNationIndex(
+        const CustomerTable& customers,
+        const std::unordered_set<int32_t>& regionNations
+    );
+    JoinHashTable buildOrderToCustomerIndex(
+        const OrderTable& orders,
+        const JoinHashTable& customerToNation
+    );
+    std::unordered_map<int32_t, std::string> buildNationNameIndex(const NationTable& nations);
+    BatchJoinIndexes buildBatchJoinIndexes(
+        const CustomerTable& customers,
+        const OrderTable& orders,
+        const SupplierTable& suppliers,
+        const NationTable& nations,
+        const RegionTable& regions,
+        const std::vector<QueryParameters>& queries
+    );
+
     // Merge partial results from different threads
     std::unordered_map<int32_t, double> mergeResults(
         const std::vector<std::unordered_map<int32_t, double>>& partialResults
     );
 };
 
-#endif // QUERY_PROCESSOR_H
\ No newline at end of file
+#endif // QUERY_PROCESSOR_H
@@ -0,0 +1,61 @@
+#ifndef RUNTIME_FILTER_H
+#define RUNTIME_FILTER_H
+
+#include "memory_tracker.h"
+#include <cstdint>
+#include <cstddef>
+
+// Exact membership bitmap over non-negative integer keys.
+// TPCH keys are dense, so one bit per key up to the largest inserted key is
+// both smaller and faster to probe than a hash table or Bloom filter.
+class RuntimeFilter {
+public:
+    // Create an empty filter that rejects every key
+    RuntimeFilter();
+
+    // Create a filter able to hold keys in [0, maxKey]
+    explicit RuntimeFilter(int32_t maxKey);
+
+    // Wrap a read-only bitmap of numKeys bits owned elsewhere, such as a
+    // mapped index snapshot; the words must outlive the filter
+    RuntimeFilter(const uint64_t* words, uint32_t numKeys);
+
+    RuntimeFilter(RuntimeFilter&&) = default;
+    RuntimeFilter& operator=(RuntimeFilter&&) = default;
+    RuntimeFilter(const RuntimeFilter&) = delete;
+    RuntimeFilter& operator=(const RuntimeFilter&) = delete;
+
+    // Add a key to the filter (keys outside [0, maxKey] are ignored); not
+    // allowed on a wrapped bitmap
+    void insert(int32_t key);
+
+    // Same as insert, but safe to call from several threads at once
+    void insertConcurrent(int32_t key);
+
+    // Check whether a key was inserted
+    bool contains(int32_t key) const {
+        uint32_t k = static_cast<uint32_t>(key);
+        if (k >= numKeys) {
+            return false;
+        }
+        return (words[k >> 6] >> (k & 63)) & 1;
+    }
+
+    // Number of keys set in the filter
+    size_t count() const;
+
+    // Size of the bitmap in bytes
+    size_t memoryBytes() const;
+
+    // Raw bitmap words and the number of keys they cover, for serialization
+    const uint64_t* data() const;
+    uint32_t keyCount() const;
+
+private:
+    // Owned bitmap; empty when wrapping external words
+    TrackedVector<uint64_t, MemoryCategory::RuntimeFilters> bits;
+    const uint64_t* words;
+    uint32_t numKeys;
+};
+
+#endif // RUNTIME_FILTER_H
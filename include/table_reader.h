@@ -0,0 +1,74 @@
+#ifndef TABLE_READER_H
+#define TABLE_READER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Line reader for TPCH .tbl files that may be plain, gzip or zstd compressed.
+// The format is detected from the file's magic bytes. Reading and
+// decompression run on a background thread and are pipelined with parsing;
+// zstd files with several frames are decompressed by multiple threads.
+class TableReader {
+public:
+    // Open a file and start reading it in the background
+    explicit TableReader(const std::string& filePath);
+
+    // Stop the background reader and close the file
+    ~TableReader();
+
+    TableReader(const TableReader&) = delete;
+    TableReader& operator=(const TableReader&) = delete;
+
+    // Check whether the file was opened and its format is supported
+    bool isOpen() const;
+
+    // Read the next line without its newline; returns false at end of input
+    bool readLine(std::string& line);
+
+private:
+    enum class Format {
+        Plain,
+        Gzip,
+        Zstd
+    };
+
+    using Block = std::vector<char>;
+
+    // Producers for each format, run on the background thread
+    void readPlain();
+    void readGzip();
+    void readZstd();
+
+    // Hand a decompressed block to the consumer; returns false once cancelled
+    bool pushBlock(Block&& block);
+
+    // Mark the end of input, reporting an error if one occurred
+    void finish(const std::string& error);
+
+    // Take the next block from the queue; returns false at end of input
+    bool nextBlock();
+
+    std::string path;
+    Format format;
+    bool opened;
+    int fd;
+
+    std::thread producer;
+    std::mutex queueMutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<Block> blocks;
+    bool done;
+    bool cancelled;
+
+    // Block being consumed by readLine
+    Block current;
+    size_t position;
+};
+
+#endif // TABLE_READER_H
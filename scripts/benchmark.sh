@@ -0,0 +1,302 @@
+#!/bin/bash
+
+# Script to benchmark the TPCH Query 5 implementation across scale factors
+# and thread counts, check results against golden answers and gate on
+# throughput regressions against a stored baseline
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+REPO_DIR="$(dirname "$SCRIPT_DIR")"
+
+# Default values
+SCALES=""
+THREAD_COUNTS=""
+DATA_ROOT="/app/data/bench"
+BINARY=""
+RUNS=3
+MARGIN=0.10
+GOLDEN_DIR="$REPO_DIR/benchmarks/golden"
+BASELINE_FILE="$REPO_DIR/benchmarks/baseline.csv"
+RESULTS_FILE="benchmark_results.csv"
+UPDATE_GOLDEN=0
+UPDATE_BASELINE=0
+
+# Parse command line arguments
+while [[ $# -gt 0 ]]; do
+    key="$1"
+    case $key in
+        --scales|-s)
+            SCALES="$2"
+            shift
+            shift
+            ;;
+        --threads|-t)
+            THREAD_COUNTS="$2"
+            shift
+            shift
+            ;;
+        --data-root|-d)
+            DATA_ROOT="$2"
+            shift
+            shift
+            ;;
+        --binary|-b)
+            BINARY="$2"
+            shift
+            shift
+            ;;
+        --runs|-n)
+            RUNS="$2"
+            shift
+            shift
+            ;;
+        --margin|-m)
+            MARGIN="$2"
+            shift
+            shift
+            ;;
+        --golden-dir)
+            GOLDEN_DIR="$2"
+            shift
+            shift
+            ;;
+        --baseline)
+            BASELINE_FILE="$2"
+            shift
+            shift
+            ;;
+        --output|-o)
+            RESULTS_FILE="$2"
+            shift
+            shift
+            ;;
+        --update-golden)
+            UPDATE_GOLDEN=1
+            shift
+            ;;
+        --update-baseline)
+            UPDATE_BASELINE=1
+            shift
+            ;;
+        --help|-h)
+            echo "Usage: $0 [OPTIONS]"
+            echo "Options:"
+            echo "  --scales, -s LIST      Scale factors to run (default: those with a golden answer)"
+            echo "  --threads, -t LIST     Thread counts to sweep (default: 1 2 4 ... up to all cores)"
+            echo "  --data-root, -d DIR    Directory holding one sf<N> data directory per scale factor;"
+            echo "                         missing ones are generated (default: /app/data/bench)"
+            echo "  --binary, -b PATH      Path to tpch_query5 (default: /app/build/tpch_query5 or ./tpch_query5)"
+            echo "  --runs, -n NUM         Runs per configuration, the fastest is kept (default: 3)"
+            echo "  --margin, -m FRACTION  Allowed throughput drop from the baseline (default: 0.10)"
+            echo "  --golden-dir DIR       Golden answer directory (default: benchmarks/golden)"
+            echo "  --baseline FILE        Baseline throughput file (default: benchmarks/baseline.csv)"
+            echo "  --output, -o FILE      Results CSV file (default: benchmark_results.csv)"
+            echo "  --update-golden        Store the results of this run as golden answers"
+            echo "  --update-baseline      Store the throughput of this run as the baseline"
+            echo "  --help, -h             Display this help message"
+            exit 0
+            ;;
+        *)
+            echo "Unknown option: $1"
+            exit 1
+            ;;
+    esac
+done
+
+# Locate the executable
+if [ -z "$BINARY" ]; then
+    for candidate in /app/build/tpch_query5 "$REPO_DIR/build/tpch_query5" ./tpch_query5; do
+        if [ -x "$candidate" ]; then
+            BINARY="$candidate"
+            break
+        fi
+    done
+fi
+if [ -z "$BINARY" ] || [ ! -x "$BINARY" ]; then
+    echo "Error: Executable not found"
+    exit 1
+fi
+
+# Default scale factors: those with a golden answer, so a default run
+# checks every result it produces
+if [ -z "$SCALES" ]; then
+    SCALES=$(ls "$GOLDEN_DIR" 2>/dev/null | sed -n 's/^sf\(.*\)\.csv$/\1/p' | sort -g | tr '\n' ' ')
+    if [ -z "$SCALES" ]; then
+        echo "Error: No golden answers in $GOLDEN_DIR; pass --scales with --update-golden to record some"
+        exit 1
+    fi
+fi
+
+# Default thread sweep: powers of two up to the number of cores, plus all cores
+if [ -z "$THREAD_COUNTS" ]; then
+    CORES=$(nproc)
+    THREAD_COUNTS=""
+    t=1
+    while [ "$t" -lt "$CORES" ]; do
+        THREAD_COUNTS="$THREAD_COUNTS $t"
+        t=$((t * 2))
+    done
+    THREAD_COUNTS="$THREAD_COUNTS $CORES"
+fi
+
+# Return the first existing, possibly compressed, copy of a table
+find_table() {
+    for candidate in "$1/$2.tbl" "$1/$2.tbl.gz" "$1/$2.tbl.zst"; do
+        if [ -f "$candidate" ]; then
+            echo "$candidate"
+            return 0
+        fi
+    done
+    return 1
+}
+
+# Compare two result files row by row, allowing rounding differences
+compare_results() {
+    awk -F, '
+        NR == FNR { expected[NR] = $0; count = NR; next }
+        {
+            actual[FNR] = $0
+            rows = FNR
+        }
+        END {
+            if (rows != count) { exit 1 }
+            for (i = 1; i <= rows; i++) {
+                split(expected[i], e, ",")
+                split(actual[i], a, ",")
+                if (e[1] != a[1]) { exit 1 }
+                if (i > 1) {
+                    diff = e[2] - a[2]
+                    if (diff < 0) { diff = -diff }
+                    if (diff > 0.01) { exit 1 }
+                }
+            }
+        }
+    ' "$1" "$2"
+}
+
+# generate_data.sh changes directory before moving its output, so the
+# data root must be absolute
+mkdir -p "$DATA_ROOT"
+DATA_ROOT=$(cd "$DATA_ROOT" && pwd)
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+FAILED=0
+echo "scale,threads,load_ms,query_ms,lineitems,rows_per_sec,speedup,efficiency,build_ms,build_speedup" > "$RESULTS_FILE"
+
+for scale in $SCALES; do
+    DATA_DIR="$DATA_ROOT/sf$scale"
+
+    # Generate the data set if it is missing
+    if ! find_table "$DATA_DIR" lineitem > /dev/null; then
+        echo "Generating scale factor $scale in $DATA_DIR..."
+        if ! "$SCRIPT_DIR/generate_data.sh" --scale "$scale" --output "$DATA_DIR"; then
+            echo "Error: Data generation failed for scale factor $scale"
+            exit 1
+        fi
+    fi
+
+    ARGS=""
+    for table in customer orders lineitem supplier nation region; do
+        path=$(find_table "$DATA_DIR" "$table") || {
+            echo "Error: Data file $DATA_DIR/$table.tbl does not exist"
+            exit 1
+        }
+        ARGS="$ARGS --$table-path $path"
+    done
+    ARGS="$ARGS --region-name ASIA --date-from 1994-01-01 --date-to 1995-01-01"
+
+    BASE_RATE=""
+    BASE_BUILD=""
+    for threads in $THREAD_COUNTS; do
+        BEST_QUERY=""
+        BEST_LOAD=""
+        BEST_BUILD=""
+        RESULT="$WORK_DIR/sf${scale}_t${threads}.csv"
+
+        for ((run = 1; run <= RUNS; run++)); do
+            LOG="$WORK_DIR/run.log"
+            if ! $BINARY $ARGS --threads "$threads" --output "$RESULT" > "$LOG" 2>&1; then
+                echo "Error: Run failed for scale factor $scale with $threads threads"
+                cat "$LOG"
+                exit 1
+            fi
+
+            LOAD_MS=$(sed -n 's/^Data loading completed in \([0-9]*\) ms$/\1/p' "$LOG")
+            QUERY_MS=$(sed -n 's/^Query processing completed in \([0-9]*\) ms$/\1/p' "$LOG")
+            BUILD_MS=$(sed -n 's/^Index build completed in \([0-9]*\) ms$/\1/p' "$LOG")
+            LINEITEMS=$(sed -n 's/^Loaded \([0-9]*\) line items$/\1/p' "$LOG")
+
+            if [ -z "$BEST_QUERY" ] || [ "$QUERY_MS" -lt "$BEST_QUERY" ]; then
+                BEST_QUERY=$QUERY_MS
+            fi
+            if [ -z "$BEST_LOAD" ] || [ "$LOAD_MS" -lt "$BEST_LOAD" ]; then
+                BEST_LOAD=$LOAD_MS
+            fi
+            if [ -z "$BEST_BUILD" ] || [ "$BUILD_MS" -lt "$BEST_BUILD" ]; then
+                BEST_BUILD=$BUILD_MS
+            fi
+        done
+
+        # Throughput of the query phase; a 0 ms run counts as 1 ms
+        RATE=$(awk -v rows="$LINEITEMS" -v ms="$BEST_QUERY" 'BEGIN { if (ms < 1) ms = 1; printf "%.0f", rows * 1000 / ms }')
+        if [ -z "$BASE_RATE" ]; then
+            BASE_RATE=$RATE
+            BASE_BUILD=$BEST_BUILD
+            BASE_THREADS=$threads
+        fi
+        SPEEDUP=$(awk -v r="$RATE" -v b="$BASE_RATE" 'BEGIN { printf "%.2f", r / b }')
+        EFFICIENCY=$(awk -v s="$SPEEDUP" -v t="$threads" -v b="$BASE_THREADS" 'BEGIN { printf "%.2f", s * b / t }')
+        # Speedup of the join index build alone, which is also part of query_ms
+        BUILD_SPEEDUP=$(awk -v ms="$BEST_BUILD" -v b="$BASE_BUILD" 'BEGIN { if (ms < 1) ms = 1; if (b < 1) b = 1; printf "%.2f", b / ms }')
+
+        echo "$scale,$threads,$BEST_LOAD,$BEST_QUERY,$LINEITEMS,$RATE,$SPEEDUP,$EFFICIENCY,$BEST_BUILD,$BUILD_SPEEDUP" >> "$RESULTS_FILE"
+        printf "sf %-5s threads %-4s load %8s ms  build %6s ms  query %8s ms  %12s rows/s  efficiency %s\n" \
+            "$scale" "$threads" "$BEST_LOAD" "$BEST_BUILD" "$BEST_QUERY" "$RATE" "$EFFICIENCY"
+
+        # Results must not depend on the thread count
+        GOLDEN="$GOLDEN_DIR/sf$scale.csv"
+        if [ "$UPDATE_GOLDEN" -eq 1 ] && [ "$threads" = "$BASE_THREADS" ]; then
+            mkdir -p "$GOLDEN_DIR"
+            cp "$RESULT" "$GOLDEN"
+        elif [ -f "$GOLDEN" ]; then
+            if ! compare_results "$GOLDEN" "$RESULT"; then
+                echo "FAIL: sf $scale with $threads threads does not match $GOLDEN"
+                diff "$GOLDEN" "$RESULT"
+                FAILED=1
+            fi
+        else
+            echo "FAIL: No golden answer at $GOLDEN; run with --update-golden to record one"
+            FAILED=1
+        fi
+    done
+done
+
+# Throughput regression gate
+if [ "$UPDATE_BASELINE" -eq 1 ]; then
+    mkdir -p "$(dirname "$BASELINE_FILE")"
+    cut -d, -f1,2,6 "$RESULTS_FILE" > "$BASELINE_FILE"
+    echo "Baseline written to $BASELINE_FILE"
+elif [ -f "$BASELINE_FILE" ]; then
+    if ! awk -F, -v margin="$MARGIN" '
+        NR == FNR { if (FNR > 1) baseline[$1 "," $2] = $3; next }
+        FNR > 1 && ($1 "," $2) in baseline {
+            limit = baseline[$1 "," $2] * (1 - margin)
+            if ($6 < limit) {
+                printf "FAIL: sf %s with %s threads: %s rows/s is below %.0f (baseline %s)\n", $1, $2, $6, limit, baseline[$1 "," $2]
+                failed = 1
+            }
+        }
+        END { exit failed }
+    ' "$BASELINE_FILE" "$RESULTS_FILE"; then
+        FAILED=1
+    fi
+else
+    echo "Note: No baseline at $BASELINE_FILE; run with --update-baseline to record one"
+fi
+
+echo "Results written to $RESULTS_FILE"
+if [ "$FAILED" -ne 0 ]; then
+    echo "Benchmark failed"
+    exit 1
+fi
+echo "Benchmark passed"
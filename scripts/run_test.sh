@@ -69,10 +69,20 @@ if [ ! -d "$DATA_DIR" ]; then
     exit 1
 fi
 
-# Check if data files exist
-for file in customer.tbl orders.tbl lineitem.tbl supplier.tbl nation.tbl region.tbl; do
-    if [ ! -f "$DATA_DIR/$file" ]; then
-        echo "Error: Data file $DATA_DIR/$file does not exist"
+# Find each data file, accepting gzip or zstd compressed copies
+find_table() {
+    for candidate in "$DATA_DIR/$1.tbl" "$DATA_DIR/$1.tbl.gz" "$DATA_DIR/$1.tbl.zst"; do
+        if [ -f "$candidate" ]; then
+            echo "$candidate"
+            return 0
+        fi
+    done
+    return 1
+}
+
+for table in customer orders lineitem supplier nation region; do
+    if ! find_table "$table" > /dev/null; then
+        echo "Error: Data file $DATA_DIR/$table.tbl does not exist"
         exit 1
     fi
 done
@@ -88,12 +98,12 @@ if [ ! -f "$CMD" ]; then
 fi
 
 # Build arguments
-ARGS="--customer-path $DATA_DIR/customer.tbl"
-ARGS="$ARGS --orders-path $DATA_DIR/orders.tbl"
-ARGS="$ARGS --lineitem-path $DATA_DIR/lineitem.tbl"
-ARGS="$ARGS --supplier-path $DATA_DIR/supplier.tbl"
-ARGS="$ARGS --nation-path $DATA_DIR/nation.tbl"
-ARGS="$ARGS --region-path $DATA_DIR/region.tbl"
+ARGS="--customer-path $(find_table customer)"
+ARGS="$ARGS --orders-path $(find_table orders)"
+ARGS="$ARGS --lineitem-path $(find_table lineitem)"
+ARGS="$ARGS --supplier-path $(find_table supplier)"
+ARGS="$ARGS --nation-path $(find_table nation)"
+ARGS="$ARGS --region-path $(find_table region)"
 ARGS="$ARGS --region-name $REGION_NAME"
 ARGS="$ARGS --date-from $DATE_FROM"
 ARGS="$ARGS --date-to $DATE_TO"
@@ -0,0 +1,119 @@
+// Stress check for the concurrent join index build: many threads insert
+// interleaved keys into one JoinHashTable and RuntimeFilter at the same
+// time, with two threads racing on every key so exactly one insert must
+// win. Once all threads are done, every key is inserted again with another
+// value, which must not replace the stored one. Every key, value and
+// filter bit is then verified.
+//
+// Usage: stress_join_index [threads] [keys] [rounds]
+
+#include "../include/join_hash_table.h"
+#include "../include/runtime_filter.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Run one round; returns the number of errors found
+size_t runRound(size_t numThreads, int32_t numKeys) {
+    // Even keys only, so odd keys probe for absent entries and filter bits
+    JoinHashTable table(MemoryCategory::OrderIndex, static_cast<size_t>(numKeys));
+    RuntimeFilter filter(numKeys * 2);
+
+    std::atomic<size_t> ready(0);
+    std::atomic<size_t> finished(0);
+    std::vector<size_t> inserted(numThreads, 0);
+    std::vector<size_t> reinserted(numThreads, 0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            // Start together so the threads contend for neighbouring slots
+            ready.fetch_add(1);
+            while (ready.load() < numThreads) {
+            }
+            // Each thread inserts its own share of the keys and, in step,
+            // the share of the next thread
+            int32_t step = static_cast<int32_t>(numThreads);
+            int32_t shares[2] = {static_cast<int32_t>(t), static_cast<int32_t>((t + 1) % numThreads)};
+            for (int32_t base = 0; base < numKeys; base += step) {
+                for (int32_t share : shares) {
+                    int32_t key = base + share;
+                    if (key < numKeys) {
+                        inserted[t] += table.insertConcurrent(key * 2, key);
+                        filter.insertConcurrent(key * 2);
+                    }
+                }
+            }
+            finished.fetch_add(1);
+            while (finished.load() < numThreads) {
+            }
+            for (int32_t key = static_cast<int32_t>(t); key < numKeys; key += step) {
+                reinserted[t] += table.insertConcurrent(key * 2, -1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    size_t total = 0;
+    size_t duplicates = 0;
+    for (size_t t = 0; t < numThreads; ++t) {
+        total += inserted[t];
+        duplicates += reinserted[t];
+    }
+    table.commitConcurrentInserts(total);
+
+    size_t errors = 0;
+    if (duplicates != 0) {
+        std::cerr << duplicates << " reinserted keys were added again" << std::endl;
+        ++errors;
+    }
+    if (table.size() != static_cast<size_t>(numKeys)) {
+        std::cerr << "table holds " << table.size() << " entries, expected " << numKeys << std::endl;
+        ++errors;
+    }
+    if (filter.count() != static_cast<size_t>(numKeys)) {
+        std::cerr << "filter holds " << filter.count() << " keys, expected " << numKeys << std::endl;
+        ++errors;
+    }
+    for (int32_t key = 0; key < numKeys; ++key) {
+        const int32_t* value = table.find(key * 2);
+        if (value == nullptr || *value != key) {
+            ++errors;
+        }
+        if (table.find(key * 2 + 1) != nullptr) {
+            ++errors;
+        }
+        if (!filter.contains(key * 2) || filter.contains(key * 2 + 1)) {
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t numThreads = argc > 1 ? std::stoul(argv[1]) : 8;
+    int32_t numKeys = argc > 2 ? std::stoi(argv[2]) : 2000000;
+    size_t rounds = argc > 3 ? std::stoul(argv[3]) : 5;
+
+    if (numThreads == 0 || numKeys <= 0 || numKeys > (INT32_MAX - 1) / 2) {
+        std::cerr << "Error: Invalid thread or key count" << std::endl;
+        return 1;
+    }
+
+    size_t errors = 0;
+    for (size_t round = 0; round < rounds; ++round) {
+        errors += runRound(numThreads, numKeys);
+    }
+
+    std::cout << rounds << " rounds of " << numKeys << " keys with " << numThreads << " threads: " << errors
+              << " errors" << std::endl;
+    return errors == 0 ? 0 : 1;
+}
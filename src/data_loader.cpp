@@ -1,16 +1,16 @@
 #include "../include/data_loader.h"
 
-std::vector<Customer> DataLoader::loadCustomers(const std::string& filePath) {
-    std::vector<Customer> customers;
-    std::ifstream file(filePath);
+CustomerTable DataLoader::loadCustomers(const std::string& filePath) {
+    CustomerTable customers;
+    TableReader file(filePath);
     std::string line;
     
-    if (!file.is_open()) {
+    if (!file.isOpen()) {
         std::cerr << "Error: Could not open customer file: " << filePath << std::endl;
         return customers;
     }
     
-    while (std::getline(file, line)) {
+    while (file.readLine(line)) {
         auto fields = splitLine(line, '|');
         if (fields.size() >= 4) {
             int32_t custkey = std::stoi(fields[0]);
@@ -22,17 +22,17 @@ std::vector<Customer> DataLoader::loadCustomers(const std::string& filePath) {
     return customers;
 }
 
-std::vector<Order> DataLoader::loadOrders(const std::string& filePath, const Date& dateFrom, const Date& dateTo) {
-    std::vector<Order> orders;
-    std::ifstream file(filePath);
+OrderTable DataLoader::loadOrders(const std::string& filePath, const Date& dateFrom, const Date& dateTo) {
+    OrderTable orders;
+    TableReader file(filePath);
     std::string line;
     
-    if (!file.is_open()) {
+    if (!file.isOpen()) {
         std::cerr << "Error: Could not open orders file: " << filePath << std::endl;
         return orders;
     }
     
-    while (std::getline(file, line)) {
+    while (file.readLine(line)) {
         auto fields = splitLine(line, '|');
         if (fields.size() >= 5) {
             int32_t orderkey = std::stoi(fields[0]);
@@ -49,17 +49,17 @@ std::vector<Order> DataLoader::loadOrders(const std::string& filePath, const Dat
     return orders;
 }
 
-std::vector<LineItem> DataLoader::loadLineItems(const std::string& filePath) {
-    std::vector<LineItem> lineItems;
-    std::ifstream file(filePath);
+LineItemTable DataLoader::loadLineItems(const std::string& filePath) {
+    LineItemTable lineItems;
+    TableReader file(filePath);
     std::string line;
     
-    if (!file.is_open()) {
+    if (!file.isOpen()) {
         std::cerr << "Error: Could not open lineitem file: " << filePath << std::endl;
         return lineItems;
     }
     
-    while (std::getline(file, line)) {
+    while (file.readLine(line)) {
         auto fields = splitLine(line, '|');
         if (fields.size() >= 6) {
             int32_t orderkey = std::stoi(fields[0]);
@@ -74,17 +74,17 @@ std::vector<LineItem> DataLoader::loadLineItems(const std::string& filePath) {
     return lineItems;
 }
 
-std::vector<Supplier> DataLoader::loadSuppliers(const std::string& filePath) {
-    std::vector<Supplier> suppliers;
-    std::ifstream file(filePath);
+SupplierTable DataLoader::loadSuppliers(const std::string& filePath) {
+    SupplierTable suppliers;
+    TableReader file(filePath);
     std::string line;
     
-    if (!file.is_open()) {
+    if (!file.isOpen()) {
         std::cerr << "Error: Could not open supplier file: " << filePath << std::endl;
         return suppliers;
     }
     
-    while (std::getline(file, line)) {
+    while (file.readLine(line)) {
         auto fields = splitLine(line, '|');
         if (fields.size() >= 4) {
             int32_t suppkey = std::stoi(fields[0]);
@@ -97,17 +97,17 @@ std::vector<Supplier> DataLoader::loadSuppliers(const std::string& filePath) {
     return suppliers;
 }
 
-std::vector<Nation> DataLoader::loadNations(const std::string& filePath) {
-    std::vector<Nation> nations;
-    std::ifstream file(filePath);
+NationTable DataLoader::loadNations(const std::string& filePath) {
+    NationTable nations;
+    TableReader file(filePath);
     std::string line;
     
-    if (!file.is_open()) {
+    if (!file.isOpen()) {
         std::cerr << "Error: Could not open nation file: " << filePath << std::endl;
         return nations;
     }
     
-    while (std::getline(file, line)) {
+    while (file.readLine(line)) {
         auto fields = splitLine(line, '|');
         if (fields.size() >= 3) {
             int32_t nationkey = std::stoi(fields[0]);
@@ -121,17 +121,17 @@ std::vector<Nation> DataLoader::loadNations(const std::string& filePath) {
     return nations;
 }
 
-std::vector<Region> DataLoader::loadRegions(const std::string& filePath, const std::string& regionName) {
-    std::vector<Region> regions;
-    std::ifstream file(filePath);
+RegionTable DataLoader::loadRegions(const std::string& filePath, const std::string& regionName) {
+    RegionTable regions;
+    TableReader file(filePath);
     std::string line;
     
-    if (!file.is_open()) {
+    if (!file.isOpen()) {
         std::cerr << "Error: Could not open region file: " << filePath << std::endl;
         return regions;
     }
     
-    while (std::getline(file, line)) {
+    while (file.readLine(line)) {
         auto fields = splitLine(line, '|');
         if (fields.size() >= 2) {
             int32_t regionkey = std::stoi(fields[0]);
@@ -147,6 +147,37 @@ std::vector<Region> DataLoader::loadRegions(const std::string& filePath, const s
     return regions;
 }
 
+std::vector<QueryParameters> DataLoader::loadQueryBatch(const std::string& filePath) {
+    std::vector<QueryParameters> queries;
+    std::ifstream file(filePath);
+    std::string line;
+    
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open batch file: " << filePath << std::endl;
+        return queries;
+    }
+    
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        
+        auto fields = splitLine(line, ',');
+        if (fields.size() >= 3) {
+            std::string regionName = trim(fields[0]);
+            Date dateFrom = parseDate(trim(fields[1]));
+            Date dateTo = parseDate(trim(fields[2]));
+            
+            queries.emplace_back(regionName, dateFrom, dateTo);
+        } else {
+            std::cerr << "Warning: Skipping malformed batch line: " << line << std::endl;
+        }
+    }
+    
+    return queries;
+}
+
 std::vector<std::string> DataLoader::splitLine(const std::string& line, char delimiter) {
     std::vector<std::string> tokens;
     std::stringstream ss(line);
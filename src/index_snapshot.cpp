@@ -0,0 +1,419 @@
+#include "../include/index_snapshot.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'P', 'C', 'H', 'Q', '5', 'I', 'X'};
+
+// Bumped whenever the layout or the hash table hashing changes
+constexpr uint32_t kVersion = 1;
+
+// Sections start on cache line boundaries
+constexpr uint64_t kSectionAlignment = 64;
+
+// Longest nation name stored per record, including the terminator
+constexpr size_t kNationNameBytes = 28;
+
+enum class SectionKind : uint32_t {
+    OrderToCustomer = 1,
+    SupplierToNation,
+    CustomerToNation,
+    SupplierFilter,
+    OrderFilter,
+    NationNames
+};
+
+constexpr uint32_t kNumSections = 6;
+
+// All integers are stored in host byte order
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numSections;
+    uint64_t fingerprint;
+    // Checksum of every byte after the header
+    uint64_t checksum;
+    uint64_t fileSize;
+};
+
+struct SectionEntry {
+    uint32_t kind;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t bytes;
+    // Entries of a hash table, keys of a filter or records of the names
+    uint64_t count;
+};
+
+struct NationRecord {
+    int32_t nationKey;
+    char name[kNationNameBytes];
+};
+
+// 64-bit hash over 8-byte words; every section is a multiple of 8 bytes
+class Checksum {
+public:
+    void update(const void* data, size_t bytes) {
+        const char* bytePointer = static_cast<const char*>(data);
+        for (size_t i = 0; i < bytes; i += sizeof(uint64_t)) {
+            uint64_t word = 0;
+            std::memcpy(&word, bytePointer + i, std::min(sizeof(uint64_t), bytes - i));
+            state ^= word * 0x87C37B91114253D5ULL;
+            state = ((state << 31) | (state >> 33)) * 0x4CF5AD432745937FULL;
+        }
+    }
+
+    uint64_t value() const {
+        return state;
+    }
+
+private:
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+};
+
+// FNV-1a, used for the source fingerprint
+void hashBytes(uint64_t& hash, const void* data, size_t bytes) {
+    const unsigned char* bytePointer = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= bytePointer[i];
+        hash *= 0x100000001B3ULL;
+    }
+}
+
+void hashString(uint64_t& hash, const std::string& value) {
+    uint64_t length = value.size();
+    hashBytes(hash, &length, sizeof(length));
+    hashBytes(hash, value.data(), value.size());
+}
+
+uint64_t alignSection(uint64_t offset) {
+    return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+} // namespace
+
+IndexSnapshot::IndexSnapshot() : mapping(nullptr), mappingSize(0) {
+}
+
+IndexSnapshot::~IndexSnapshot() {
+    close();
+}
+
+uint64_t IndexSnapshot::fingerprint(
+    const std::vector<std::string>& sourcePaths,
+    const std::string& regionName,
+    const Date& dateFrom,
+    const Date& dateTo
+) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hashBytes(hash, &kVersion, sizeof(kVersion));
+
+    for (const auto& path : sourcePaths) {
+        hashString(hash, path);
+
+        struct stat fileStat;
+        int64_t fields[4] = {-1, -1, -1, -1};
+        if (stat(path.c_str(), &fileStat) == 0) {
+            fields[0] = static_cast<int64_t>(fileStat.st_size);
+            fields[1] = static_cast<int64_t>(fileStat.st_mtim.tv_sec);
+            fields[2] = static_cast<int64_t>(fileStat.st_mtim.tv_nsec);
+            fields[3] = static_cast<int64_t>(fileStat.st_ino);
+        }
+        hashBytes(hash, fields, sizeof(fields));
+    }
+
+    hashString(hash, regionName);
+    hashString(hash, dateFrom.toString());
+    hashString(hash, dateTo.toString());
+    return hash;
+}
+
+bool IndexSnapshot::save(const std::string& filePath, uint64_t fingerprint, const JoinIndexes& indexes) {
+    std::vector<NationRecord> nationRecords;
+    for (const auto& [nationKey, name] : indexes.nationNames) {
+        if (name.size() >= kNationNameBytes) {
+            std::cerr << "Error: Nation name too long for index snapshot: " << name << std::endl;
+            return false;
+        }
+        NationRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.nationKey = nationKey;
+        std::memcpy(record.name, name.data(), name.size());
+        nationRecords.push_back(record);
+    }
+
+    struct Payload {
+        SectionKind kind;
+        const void* data;
+        uint64_t bytes;
+        uint64_t count;
+    };
+    const JoinHashTable* tables[3] = {&indexes.orderToCustomer, &indexes.supplierToNation, &indexes.customerToNation};
+    const SectionKind tableKinds[3] = {SectionKind::OrderToCustomer, SectionKind::SupplierToNation,
+                                       SectionKind::CustomerToNation};
+    std::vector<Payload> payloads;
+    for (size_t i = 0; i < 3; ++i) {
+        payloads.push_back({tableKinds[i], tables[i]->data(), tables[i]->slotCount() * sizeof(JoinHashTable::Slot),
+                            tables[i]->size()});
+    }
+    payloads.push_back({SectionKind::SupplierFilter, indexes.supplierFilter.data(),
+                        indexes.supplierFilter.memoryBytes(), indexes.supplierFilter.keyCount()});
+    payloads.push_back({SectionKind::OrderFilter, indexes.orderFilter.data(),
+                        indexes.orderFilter.memoryBytes(), indexes.orderFilter.keyCount()});
+    payloads.push_back({SectionKind::NationNames, nationRecords.data(), nationRecords.size() * sizeof(NationRecord),
+                        nationRecords.size()});
+
+    // Lay out the sections after the header and section table
+    std::vector<SectionEntry> sections;
+    uint64_t offset = alignSection(sizeof(FileHeader) + kNumSections * sizeof(SectionEntry));
+    for (const auto& payload : payloads) {
+        SectionEntry entry;
+        entry.kind = static_cast<uint32_t>(payload.kind);
+        entry.reserved = 0;
+        entry.offset = offset;
+        entry.bytes = payload.bytes;
+        entry.count = payload.count;
+        sections.push_back(entry);
+        offset = alignSection(offset + payload.bytes);
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.numSections = kNumSections;
+    header.fingerprint = fingerprint;
+    header.checksum = 0;
+    header.fileSize = offset;
+
+    // Written under a unique temporary name and renamed so readers never
+    // see a partial snapshot and concurrent writers never share a file
+    std::string tempPath = filePath + ".XXXXXX";
+    int fd = mkstemp(tempPath.data());
+    if (fd < 0) {
+        std::cerr << "Error: Could not create index snapshot: " << tempPath << std::endl;
+        return false;
+    }
+
+    Checksum checksum;
+    uint64_t written = 0;
+    bool ok = true;
+    auto writeAt = [&](const void* data, uint64_t bytes, uint64_t position) {
+        const char* bytePointer = static_cast<const char*>(data);
+        while (ok && bytes > 0) {
+            ssize_t result = pwrite(fd, bytePointer, bytes, static_cast<off_t>(position));
+            if (result <= 0) {
+                ok = false;
+                break;
+            }
+            bytePointer += result;
+            bytes -= static_cast<uint64_t>(result);
+            position += static_cast<uint64_t>(result);
+        }
+    };
+    auto write = [&](const void* data, uint64_t bytes) {
+        if (bytes > 0) {
+            writeAt(data, bytes, written);
+            if (written >= sizeof(FileHeader)) {
+                checksum.update(data, bytes);
+            }
+            written += bytes;
+        }
+    };
+    static const char padding[kSectionAlignment] = {};
+    auto pad = [&](uint64_t target) {
+        write(padding, target - written);
+    };
+
+    write(&header, sizeof(header));
+    write(sections.data(), sections.size() * sizeof(SectionEntry));
+    for (size_t i = 0; i < payloads.size(); ++i) {
+        pad(sections[i].offset);
+        write(payloads[i].data, payloads[i].bytes);
+    }
+    pad(header.fileSize);
+
+    header.checksum = checksum.value();
+    writeAt(&header, sizeof(header), 0);
+
+    // mkstemp creates the file private to its owner; give the snapshot the
+    // mode of a normally created file so other users can share it
+    mode_t mask = umask(0);
+    umask(mask);
+    if (fchmod(fd, 0666 & ~mask) != 0) {
+        ok = false;
+    }
+    if (::close(fd) != 0) {
+        ok = false;
+    }
+
+    if (!ok || std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+        std::cerr << "Error: Could not write index snapshot: " << filePath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool IndexSnapshot::open(const std::string& filePath, uint64_t fingerprint) {
+    close();
+
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        std::cout << "Ignoring index snapshot " << filePath << ": file is truncated" << std::endl;
+        return false;
+    }
+
+    // The checksum reads every page anyway, so populate the mapping up front
+    mappingSize = static_cast<size_t>(fileStat.st_size);
+    void* address = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        mappingSize = 0;
+        std::cout << "Ignoring index snapshot " << filePath << ": mmap failed" << std::endl;
+        return false;
+    }
+    mapping = address;
+    MemoryTracker::recordMapping(MemoryCategory::IndexSnapshot, mappingSize);
+
+    const char* base = static_cast<const char*>(mapping);
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        return reject(filePath, "not an index snapshot");
+    }
+    if (header.version != kVersion) {
+        return reject(filePath, "unsupported version " + std::to_string(header.version));
+    }
+    if (header.fileSize != mappingSize || header.numSections != kNumSections ||
+        sizeof(FileHeader) + kNumSections * sizeof(SectionEntry) > mappingSize) {
+        return reject(filePath, "file is truncated");
+    }
+    if (header.fingerprint != fingerprint) {
+        return reject(filePath, "source files or query parameters changed");
+    }
+
+    Checksum checksum;
+    checksum.update(base + sizeof(FileHeader), mappingSize - sizeof(FileHeader));
+    if (checksum.value() != header.checksum) {
+        return reject(filePath, "checksum mismatch");
+    }
+
+    const SectionEntry* sections = reinterpret_cast<const SectionEntry*>(base + sizeof(FileHeader));
+    uint32_t seenKinds = 0;
+    for (uint32_t i = 0; i < kNumSections; ++i) {
+        const SectionEntry& section = sections[i];
+        if (section.kind < 1 || section.kind > kNumSections) {
+            return reject(filePath, "unknown section");
+        }
+        uint32_t kindBit = 1u << section.kind;
+        if ((seenKinds & kindBit) != 0) {
+            return reject(filePath, "duplicate section");
+        }
+        seenKinds |= kindBit;
+        if (section.offset % kSectionAlignment != 0 || section.offset > mappingSize ||
+            section.bytes > mappingSize - section.offset) {
+            return reject(filePath, "section out of bounds");
+        }
+        const char* data = base + section.offset;
+
+        switch (static_cast<SectionKind>(section.kind)) {
+            case SectionKind::OrderToCustomer:
+            case SectionKind::SupplierToNation:
+            case SectionKind::CustomerToNation: {
+                // Lookups hash with a shift of 64 - log2(capacity) and stop
+                // at the first empty slot, so the table needs at least two
+                // slots and must be at most half full
+                size_t capacity = section.bytes / sizeof(JoinHashTable::Slot);
+                if (capacity < 2 || (capacity & (capacity - 1)) != 0 ||
+                    section.bytes != capacity * sizeof(JoinHashTable::Slot) || section.count > capacity / 2) {
+                    return reject(filePath, "malformed hash table");
+                }
+                const JoinHashTable::Slot* slots = reinterpret_cast<const JoinHashTable::Slot*>(data);
+                uint64_t occupied = 0;
+                for (size_t slot = 0; slot < capacity; ++slot) {
+                    occupied += slots[slot].key != JoinHashTable::kEmptyKey;
+                }
+                if (occupied != section.count) {
+                    return reject(filePath, "malformed hash table");
+                }
+                JoinHashTable table(slots, capacity, section.count);
+                if (section.kind == static_cast<uint32_t>(SectionKind::OrderToCustomer)) {
+                    views.orderToCustomer = std::move(table);
+                } else if (section.kind == static_cast<uint32_t>(SectionKind::SupplierToNation)) {
+                    views.supplierToNation = std::move(table);
+                } else {
+                    views.customerToNation = std::move(table);
+                }
+                break;
+            }
+            case SectionKind::SupplierFilter:
+            case SectionKind::OrderFilter: {
+                if (section.count > UINT32_MAX || (section.count + 63) / 64 * sizeof(uint64_t) != section.bytes) {
+                    return reject(filePath, "malformed runtime filter");
+                }
+                RuntimeFilter filter(reinterpret_cast<const uint64_t*>(data), static_cast<uint32_t>(section.count));
+                if (section.kind == static_cast<uint32_t>(SectionKind::SupplierFilter)) {
+                    views.supplierFilter = std::move(filter);
+                } else {
+                    views.orderFilter = std::move(filter);
+                }
+                break;
+            }
+            case SectionKind::NationNames: {
+                if (section.count * sizeof(NationRecord) != section.bytes) {
+                    return reject(filePath, "malformed nation names");
+                }
+                const NationRecord* records = reinterpret_cast<const NationRecord*>(data);
+                for (uint64_t record = 0; record < section.count; ++record) {
+                    views.nationNames[records[record].nationKey] =
+                        std::string(records[record].name, strnlen(records[record].name, kNationNameBytes));
+                }
+                break;
+            }
+            default:
+                return reject(filePath, "unknown section");
+        }
+    }
+
+    // Each section must appear exactly once so that no index is left empty
+    if (seenKinds != ((1u << (kNumSections + 1)) - 2)) {
+        return reject(filePath, "missing section");
+    }
+
+    return true;
+}
+
+const JoinIndexes& IndexSnapshot::indexes() const {
+    return views;
+}
+
+bool IndexSnapshot::reject(const std::string& filePath, const std::string& reason) {
+    std::cout << "Ignoring index snapshot " << filePath << ": " << reason << std::endl;
+    close();
+    return false;
+}
+
+void IndexSnapshot::close() {
+    views = JoinIndexes();
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+        MemoryTracker::releaseMapping(MemoryCategory::IndexSnapshot, mappingSize);
+        mapping = nullptr;
+    }
+    mappingSize = 0;
+}
@@ -0,0 +1,104 @@
+#include "../include/join_hash_table.h"
+#include <algorithm>
+#include <utility>
+
+JoinHashTable::JoinHashTable()
+    : slots(nullptr), capacity(0), mask(0), shift(64), entries(0), category(MemoryCategory::OrderIndex), owned(true) {
+}
+
+JoinHashTable::JoinHashTable(MemoryCategory category, size_t expectedEntries)
+    : slots(nullptr), capacity(0), mask(0), shift(64), entries(0), category(category), owned(true) {
+    // Keep the load factor at or below one half so probe sequences stay short
+    capacity = 2;
+    shift = 63;
+    while (capacity < expectedEntries * 2) {
+        capacity <<= 1;
+        --shift;
+    }
+    mask = capacity - 1;
+
+    slots = static_cast<Slot*>(MemoryTracker::allocate(category, capacity * sizeof(Slot)));
+    std::fill(slots, slots + capacity, Slot{kEmptyKey, 0});
+}
+
+JoinHashTable::JoinHashTable(const Slot* slots, size_t capacity, size_t entries)
+    : slots(const_cast<Slot*>(slots)), capacity(capacity), mask(capacity - 1), shift(64), entries(entries),
+      category(MemoryCategory::OrderIndex), owned(false) {
+    for (size_t size = capacity; size > 1; size >>= 1) {
+        --shift;
+    }
+}
+
+JoinHashTable::~JoinHashTable() {
+    release();
+}
+
+JoinHashTable::JoinHashTable(JoinHashTable&& other) noexcept
+    : slots(other.slots), capacity(other.capacity), mask(other.mask), shift(other.shift),
+      entries(other.entries), category(other.category), owned(other.owned) {
+    other.slots = nullptr;
+    other.capacity = 0;
+    other.entries = 0;
+}
+
+JoinHashTable& JoinHashTable::operator=(JoinHashTable&& other) noexcept {
+    if (this != &other) {
+        release();
+        slots = std::exchange(other.slots, nullptr);
+        capacity = std::exchange(other.capacity, 0);
+        mask = other.mask;
+        shift = other.shift;
+        entries = std::exchange(other.entries, 0);
+        category = other.category;
+        owned = other.owned;
+    }
+    return *this;
+}
+
+const JoinHashTable::Slot* JoinHashTable::data() const {
+    return slots;
+}
+
+size_t JoinHashTable::slotCount() const {
+    return capacity;
+}
+
+bool JoinHashTable::insertConcurrent(int32_t key, int32_t value) {
+    if (key == kEmptyKey || capacity == 0) {
+        return false;
+    }
+
+    // Readers only run after the build has been joined, so relaxed
+    // ordering is enough; the CAS only has to make slot claims exclusive
+    for (size_t slot = slotFor(key);; slot = (slot + 1) & mask) {
+        int32_t current = __atomic_load_n(&slots[slot].key, __ATOMIC_RELAXED);
+        if (current == kEmptyKey) {
+            if (__atomic_compare_exchange_n(&slots[slot].key, &current, key, false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&slots[slot].value, value, __ATOMIC_RELAXED);
+                return true;
+            }
+            // Another thread claimed the slot; current now holds its key
+        }
+        if (current == key) {
+            return false;
+        }
+    }
+}
+
+void JoinHashTable::commitConcurrentInserts(size_t inserted) {
+    entries += inserted;
+}
+
+size_t JoinHashTable::size() const {
+    return entries;
+}
+
+void JoinHashTable::release() {
+    if (slots != nullptr && owned) {
+        MemoryTracker::deallocate(category, slots, capacity * sizeof(Slot));
+        slots = nullptr;
+    }
+    capacity = 0;
+    entries = 0;
+}
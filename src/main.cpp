@@ -2,6 +2,8 @@
 #include "../include/data_loader.h"
 #include "../include/query_processor.h"
 #include "../include/thread_pool.h"
+#include "../include/memory_tracker.h"
+#include "../include/index_snapshot.h"
 #include <iostream>
 #include <string>
 #include <chrono>
@@ -24,6 +26,24 @@ void printUsage(const char* programName) {
               << "  --date-to DATE           End date filter (format: YYYY-MM-DD, default: 1995-01-01)\n"
               << "  --threads NUM            Number of threads to use (default: number of CPU cores)\n"
               << "  --output PATH            Path to output file (default: stdout)\n"
+              << "  --batch PATH             Evaluate every \"region,date-from,date-to\" line of PATH\n"
+              << "                           in one shared scan (overrides region and date filters)\n"
+              << "  --approx                 Estimate revenues from a sample of lineitem\n"
+              << "  --sampling METHOD        Sampling method for --approx: block or uniform (default: block)\n"
+              << "  --sample-rate RATE       Maximum fraction of lineitem to sample (default: 0.01,\n"
+              << "                           or 1.0 when --target-error is given)\n"
+              << "  --target-error FRACTION  Stop once every interval half-width is within FRACTION\n"
+              << "                           of its estimate\n"
+              << "  --confidence LEVEL       Confidence level of the intervals (default: 0.95)\n"
+              << "  --probe MODE             Join probe kernel: plain or prefetch (default: prefetch)\n"
+              << "  --prefetch-group NUM     Rows per prefetch group, up to 64 (default: 16)\n"
+              << "  --memory-report          Print memory usage per structure and phase\n"
+              << "  --huge-pages MODE        Back large allocations with huge pages: off, thp or\n"
+              << "                           hugetlb (default: off)\n"
+              << "  --huge-page-threshold MB Minimum allocation size for huge pages in MiB, at least 2\n"
+              << "                           (default: 32)\n"
+              << "  --index-cache PATH       Use the join indexes saved in PATH if they match the input\n"
+              << "                           files and parameters; otherwise build and save them there\n"
               << "  --help                   Display this help message\n";
 }
 
@@ -39,6 +59,16 @@ int main(int argc, char* argv[]) {
     std::string dateFromStr = "1994-01-01";
     std::string dateToStr = "1995-01-01";
     std::string outputPath;
+    std::string batchPath;
+    bool approx = false;
+    bool sampleRateSet = false;
+    ApproxOptions approxOptions;
+    ProbeMode probeMode = ProbeMode::Prefetch;
+    size_t prefetchGroup = 16;
+    bool memoryReport = false;
+    HugePageMode hugePageMode = HugePageMode::Off;
+    size_t hugePageThresholdMb = 32;
+    std::string indexCachePath;
     size_t numThreads = std::thread::hardware_concurrency();
     
     // Parse command line arguments
@@ -70,6 +100,57 @@ int main(int argc, char* argv[]) {
             numThreads = std::stoul(argv[++i]);
         } else if (arg == "--output" && i + 1 < argc) {
             outputPath = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchPath = argv[++i];
+        } else if (arg == "--approx") {
+            approx = true;
+        } else if (arg == "--sampling" && i + 1 < argc) {
+            std::string method = argv[++i];
+            if (method == "block") {
+                approxOptions.method = SamplingMethod::Block;
+            } else if (method == "uniform") {
+                approxOptions.method = SamplingMethod::Uniform;
+            } else {
+                std::cerr << "Error: Unknown sampling method: " << method << std::endl;
+                return 1;
+            }
+        } else if (arg == "--sample-rate" && i + 1 < argc) {
+            approxOptions.sampleRate = std::stod(argv[++i]);
+            sampleRateSet = true;
+        } else if (arg == "--target-error" && i + 1 < argc) {
+            approxOptions.targetError = std::stod(argv[++i]);
+        } else if (arg == "--confidence" && i + 1 < argc) {
+            approxOptions.confidence = std::stod(argv[++i]);
+        } else if (arg == "--probe" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "plain") {
+                probeMode = ProbeMode::Plain;
+            } else if (mode == "prefetch") {
+                probeMode = ProbeMode::Prefetch;
+            } else {
+                std::cerr << "Error: Unknown probe mode: " << mode << std::endl;
+                return 1;
+            }
+        } else if (arg == "--prefetch-group" && i + 1 < argc) {
+            prefetchGroup = std::stoul(argv[++i]);
+        } else if (arg == "--memory-report") {
+            memoryReport = true;
+        } else if (arg == "--huge-pages" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "off") {
+                hugePageMode = HugePageMode::Off;
+            } else if (mode == "thp") {
+                hugePageMode = HugePageMode::Transparent;
+            } else if (mode == "hugetlb") {
+                hugePageMode = HugePageMode::Explicit;
+            } else {
+                std::cerr << "Error: Unknown huge page mode: " << mode << std::endl;
+                return 1;
+            }
+        } else if (arg == "--huge-page-threshold" && i + 1 < argc) {
+            hugePageThresholdMb = std::stoul(argv[++i]);
+        } else if (arg == "--index-cache" && i + 1 < argc) {
+            indexCachePath = argv[++i];
         } else {
             std::cerr << "Unknown option: " << arg << std::endl;
             printUsage(argv[0]);
@@ -85,31 +166,94 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    if (approx && !batchPath.empty()) {
+        std::cerr << "Error: --approx cannot be combined with --batch" << std::endl;
+        return 1;
+    }
+    if (!indexCachePath.empty() && !batchPath.empty()) {
+        std::cerr << "Error: --index-cache cannot be combined with --batch" << std::endl;
+        return 1;
+    }
+    if (approx && !sampleRateSet && approxOptions.targetError > 0.0) {
+        approxOptions.sampleRate = 1.0;
+    }
+    
+    // Must be set before the first tracked allocation
+    MemoryTracker::configureHugePages(hugePageMode, hugePageThresholdMb << 20);
+    
     // Parse dates
     Date dateFrom = Date::fromString(dateFromStr);
     Date dateTo = Date::fromString(dateToStr);
     
+    // In batch mode orders are loaded for the union of all date ranges
+    // and every region is loaded
+    std::vector<QueryParameters> batchQueries;
+    if (!batchPath.empty()) {
+        batchQueries = DataLoader::loadQueryBatch(batchPath);
+        if (batchQueries.empty()) {
+            std::cerr << "Error: No queries found in batch file: " << batchPath << std::endl;
+            return 1;
+        }
+        
+        dateFrom = batchQueries.front().dateFrom;
+        dateTo = batchQueries.front().dateTo;
+        for (const auto& query : batchQueries) {
+            if (query.dateFrom < dateFrom) {
+                dateFrom = query.dateFrom;
+            }
+            if (dateTo < query.dateTo) {
+                dateTo = query.dateTo;
+            }
+        }
+        regionName.clear();
+        std::cout << "Loaded " << batchQueries.size() << " batch queries" << std::endl;
+    }
+    
     std::cout << "Loading data..." << std::endl;
+    MemoryTracker::beginPhase("load");
     auto startTime = std::chrono::high_resolution_clock::now();
     
+    // A valid index snapshot replaces loading the build-side tables
+    IndexSnapshot snapshot;
+    uint64_t snapshotFingerprint = 0;
+    bool snapshotLoaded = false;
+    if (!indexCachePath.empty()) {
+        snapshotFingerprint = IndexSnapshot::fingerprint(
+            {customerPath, ordersPath, supplierPath, nationPath, regionPath}, regionName, dateFrom, dateTo);
+        snapshotLoaded = snapshot.open(indexCachePath, snapshotFingerprint);
+        if (snapshotLoaded) {
+            std::cout << "Loaded join indexes from " << indexCachePath << std::endl;
+        }
+    }
+    
     // Load data
-    auto customers = DataLoader::loadCustomers(customerPath);
-    std::cout << "Loaded " << customers.size() << " customers" << std::endl;
+    CustomerTable customers;
+    OrderTable orders;
+    SupplierTable suppliers;
+    NationTable nations;
+    RegionTable regions;
     
-    auto orders = DataLoader::loadOrders(ordersPath, dateFrom, dateTo);
-    std::cout << "Loaded " << orders.size() << " orders" << std::endl;
+    if (!snapshotLoaded) {
+        customers = DataLoader::loadCustomers(customerPath);
+        std::cout << "Loaded " << customers.size() << " customers" << std::endl;
+        
+        orders = DataLoader::loadOrders(ordersPath, dateFrom, dateTo);
+        std::cout << "Loaded " << orders.size() << " orders" << std::endl;
+    }
     
     auto lineItems = DataLoader::loadLineItems(lineitemPath);
     std::cout << "Loaded " << lineItems.size() << " line items" << std::endl;
     
-    auto suppliers = DataLoader::loadSuppliers(supplierPath);
-    std::cout << "Loaded " << suppliers.size() << " suppliers" << std::endl;
-    
-    auto nations = DataLoader::loadNations(nationPath);
-    std::cout << "Loaded " << nations.size() << " nations" << std::endl;
-    
-    auto regions = DataLoader::loadRegions(regionPath, regionName);
-    std::cout << "Loaded " << regions.size() << " regions" << std::endl;
+    if (!snapshotLoaded) {
+        suppliers = DataLoader::loadSuppliers(supplierPath);
+        std::cout << "Loaded " << suppliers.size() << " suppliers" << std::endl;
+        
+        nations = DataLoader::loadNations(nationPath);
+        std::cout << "Loaded " << nations.size() << " nations" << std::endl;
+        
+        regions = DataLoader::loadRegions(regionPath, regionName);
+        std::cout << "Loaded " << regions.size() << " regions" << std::endl;
+    }
     
     auto loadTime = std::chrono::high_resolution_clock::now();
     auto loadDuration = std::chrono::duration_cast<std::chrono::milliseconds>(loadTime - startTime);
@@ -118,15 +262,60 @@ int main(int argc, char* argv[]) {
     // Process query
     std::cout << "Processing query with " << numThreads << " threads..." << std::endl;
     QueryProcessor processor(numThreads);
-    auto results = processor.processQuery(customers, orders, lineItems, suppliers, nations, regions);
+    processor.setProbeMode(probeMode, prefetchGroup);
+    std::vector<QueryResult> results;
+    std::vector<std::vector<QueryResult>> batchResults;
+    ApproxSummary approxSummary;
+    
+    // With an index cache the indexes come from the snapshot, or are built
+    // here and saved for the next run
+    JoinIndexes builtIndexes;
+    const JoinIndexes* joinIndexes = nullptr;
+    if (snapshotLoaded) {
+        joinIndexes = &snapshot.indexes();
+    } else if (!indexCachePath.empty()) {
+        MemoryTracker::beginPhase("build");
+        builtIndexes = processor.buildJoinIndexes(customers, orders, suppliers, nations, regions);
+        if (IndexSnapshot::save(indexCachePath, snapshotFingerprint, builtIndexes)) {
+            std::cout << "Saved join indexes to " << indexCachePath << std::endl;
+        }
+        joinIndexes = &builtIndexes;
+    }
+    
+    if (approx && joinIndexes != nullptr) {
+        approxSummary = processor.processApproxQuery(lineItems, *joinIndexes, approxOptions);
+    } else if (approx) {
+        approxSummary = processor.processApproxQuery(customers, orders, lineItems, suppliers, nations, regions, approxOptions);
+    }
+    if (approx) {
+        std::cout << "Sampled " << approxSummary.sampledRows << " of " << lineItems.size() << " line items in "
+                  << approxSummary.rounds << " rounds";
+        if (approxOptions.targetError > 0.0) {
+            std::cout << (approxSummary.converged ? " (target error reached)" : " (target error not reached)");
+        }
+        std::cout << std::endl;
+    } else if (joinIndexes != nullptr) {
+        results = processor.processQuery(lineItems, *joinIndexes);
+    } else if (batchQueries.empty()) {
+        results = processor.processQuery(customers, orders, lineItems, suppliers, nations, regions);
+    } else {
+        batchResults = processor.processBatch(customers, orders, lineItems, suppliers, nations, regions, batchQueries);
+    }
     
     auto endTime = std::chrono::high_resolution_clock::now();
     auto queryDuration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - loadTime);
     auto totalDuration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
     
+    if (processor.lastBuildMilliseconds() >= 0) {
+        std::cout << "Index build completed in " << processor.lastBuildMilliseconds() << " ms" << std::endl;
+    }
     std::cout << "Query processing completed in " << queryDuration.count() << " ms" << std::endl;
     std::cout << "Total execution time: " << totalDuration.count() << " ms" << std::endl;
     
+    if (memoryReport) {
+        MemoryTracker::report(std::cout);
+    }
+    
     // Output results
     std::ostream* out = &std::cout;
     std::ofstream outFile;
@@ -141,9 +330,27 @@ int main(int argc, char* argv[]) {
     }
     
     // Print results
-    *out << "n_name,revenue" << std::endl;
-    for (const auto& result : results) {
-        *out << "'" << result.nation << "'," << std::fixed << std::setprecision(4) << result.revenue << std::endl;
+    if (approx) {
+        *out << "n_name,revenue,ci_lower,ci_upper" << std::endl;
+        for (const auto& result : approxSummary.results) {
+            *out << "'" << result.nation << "'," << std::fixed << std::setprecision(4) << result.revenue << ","
+                 << result.ciLower << "," << result.ciUpper << std::endl;
+        }
+    } else if (batchQueries.empty()) {
+        *out << "n_name,revenue" << std::endl;
+        for (const auto& result : results) {
+            *out << "'" << result.nation << "'," << std::fixed << std::setprecision(4) << result.revenue << std::endl;
+        }
+    } else {
+        *out << "region,date_from,date_to,n_name,revenue" << std::endl;
+        for (size_t query = 0; query < batchQueries.size(); ++query) {
+            const auto& params = batchQueries[query];
+            for (const auto& result : batchResults[query]) {
+                *out << "'" << params.regionName << "'," << params.dateFrom.toString() << ","
+                     << params.dateTo.toString() << ",'" << result.nation << "',"
+                     << std::fixed << std::setprecision(4) << result.revenue << std::endl;
+            }
+        }
     }
     
     if (!outputPath.empty()) {
@@ -0,0 +1,187 @@
+#include "../include/memory_tracker.h"
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+namespace {
+
+// Mappings are rounded to the x86-64 huge page size
+constexpr size_t kHugePageSize = size_t(2) << 20;
+
+size_t roundToHugePage(size_t bytes) {
+    return (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+}
+
+void updatePeak(std::atomic<size_t>& peak, size_t value) {
+    size_t previous = peak.load(std::memory_order_relaxed);
+    while (value > previous && !peak.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+    }
+}
+
+std::string formatBytes(size_t bytes) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << static_cast<double>(bytes) / (1024.0 * 1024.0) << " MiB";
+    return out.str();
+}
+
+// Peak resident set size of the process as reported by the kernel
+std::string readPeakResidentSet() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            size_t first = line.find_first_not_of(" \t", 6);
+            return first == std::string::npos ? "" : line.substr(first);
+        }
+    }
+    return "unavailable";
+}
+
+} // namespace
+
+std::atomic<size_t> MemoryTracker::currentBytes[MemoryTracker::kNumCategories];
+std::atomic<size_t> MemoryTracker::peakBytes[MemoryTracker::kNumCategories];
+std::atomic<size_t> MemoryTracker::totalBytes(0);
+std::atomic<size_t> MemoryTracker::totalPeakBytes(0);
+std::atomic<size_t> MemoryTracker::phasePeakBytes(0);
+std::atomic<size_t> MemoryTracker::hugePageBytes(0);
+HugePageMode MemoryTracker::hugePageMode = HugePageMode::Off;
+size_t MemoryTracker::hugePageThreshold = 0;
+std::mutex MemoryTracker::phaseMutex;
+std::string MemoryTracker::currentPhase;
+std::vector<MemoryTracker::PhaseUsage> MemoryTracker::phases;
+
+void* MemoryTracker::allocate(MemoryCategory category, size_t bytes, bool allowHugePages) {
+    void* pointer = nullptr;
+
+    if (allowHugePages && hugePageMode != HugePageMode::Off && bytes >= hugePageThreshold) {
+        size_t mappedBytes = roundToHugePage(bytes);
+        pointer = MAP_FAILED;
+
+        if (hugePageMode == HugePageMode::Explicit) {
+            pointer = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        if (pointer == MAP_FAILED) {
+            pointer = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (pointer == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            madvise(pointer, mappedBytes, MADV_HUGEPAGE);
+        }
+        hugePageBytes.fetch_add(mappedBytes, std::memory_order_relaxed);
+    } else {
+        pointer = std::malloc(bytes);
+        if (pointer == nullptr && bytes > 0) {
+            throw std::bad_alloc();
+        }
+    }
+
+    recordAllocation(category, bytes);
+    return pointer;
+}
+
+void MemoryTracker::deallocate(MemoryCategory category, void* pointer, size_t bytes, bool allowHugePages) {
+    if (pointer == nullptr) {
+        return;
+    }
+
+    if (allowHugePages && hugePageMode != HugePageMode::Off && bytes >= hugePageThreshold) {
+        size_t mappedBytes = roundToHugePage(bytes);
+        munmap(pointer, mappedBytes);
+        hugePageBytes.fetch_sub(mappedBytes, std::memory_order_relaxed);
+    } else {
+        std::free(pointer);
+    }
+
+    recordDeallocation(category, bytes);
+}
+
+void MemoryTracker::recordMapping(MemoryCategory category, size_t bytes) {
+    recordAllocation(category, bytes);
+}
+
+void MemoryTracker::releaseMapping(MemoryCategory category, size_t bytes) {
+    recordDeallocation(category, bytes);
+}
+
+void MemoryTracker::configureHugePages(HugePageMode mode, size_t threshold) {
+    hugePageMode = mode;
+    hugePageThreshold = std::max(threshold, kHugePageSize);
+}
+
+void MemoryTracker::beginPhase(const std::string& name) {
+    std::lock_guard<std::mutex> lock(phaseMutex);
+    endPhase();
+    currentPhase = name;
+    phasePeakBytes.store(totalBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void MemoryTracker::endPhase() {
+    if (!currentPhase.empty()) {
+        phases.push_back({currentPhase, phasePeakBytes.load(), totalBytes.load()});
+        currentPhase.clear();
+    }
+}
+
+void MemoryTracker::report(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(phaseMutex);
+    endPhase();
+
+    out << "Memory usage by structure:" << std::endl;
+    for (size_t i = 0; i < kNumCategories; ++i) {
+        out << "  " << std::left << std::setw(18) << categoryName(static_cast<MemoryCategory>(i))
+            << " current " << std::right << std::setw(12) << formatBytes(currentBytes[i].load())
+            << "   peak " << std::setw(12) << formatBytes(peakBytes[i].load()) << std::endl;
+    }
+    out << "  " << std::left << std::setw(18) << "total"
+        << " current " << std::right << std::setw(12) << formatBytes(totalBytes.load())
+        << "   peak " << std::setw(12) << formatBytes(totalPeakBytes.load()) << std::endl;
+
+    out << "Peak usage by phase:" << std::endl;
+    for (const auto& phase : phases) {
+        out << "  " << std::left << std::setw(18) << phase.name
+            << " peak    " << std::right << std::setw(12) << formatBytes(phase.peakBytes)
+            << "   end  " << std::setw(12) << formatBytes(phase.endBytes) << std::endl;
+    }
+
+    out << "Huge page backed: " << formatBytes(hugePageBytes.load()) << std::endl;
+    out << "Process peak RSS: " << readPeakResidentSet() << std::endl;
+}
+
+const char* MemoryTracker::categoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::Customers: return "customers";
+        case MemoryCategory::Orders: return "orders";
+        case MemoryCategory::LineItems: return "lineitems";
+        case MemoryCategory::Suppliers: return "suppliers";
+        case MemoryCategory::Nations: return "nations";
+        case MemoryCategory::Regions: return "regions";
+        case MemoryCategory::OrderIndex: return "order index";
+        case MemoryCategory::SupplierIndex: return "supplier index";
+        case MemoryCategory::CustomerIndex: return "customer index";
+        case MemoryCategory::RuntimeFilters: return "runtime filters";
+        case MemoryCategory::IndexSnapshot: return "index snapshot";
+        case MemoryCategory::Count: break;
+    }
+    return "unknown";
+}
+
+void MemoryTracker::recordAllocation(MemoryCategory category, size_t bytes) {
+    size_t index = static_cast<size_t>(category);
+    size_t categoryBytes = currentBytes[index].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    updatePeak(peakBytes[index], categoryBytes);
+
+    size_t total = totalBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    updatePeak(totalPeakBytes, total);
+    updatePeak(phasePeakBytes, total);
+}
+
+void MemoryTracker::recordDeallocation(MemoryCategory category, size_t bytes) {
+    currentBytes[static_cast<size_t>(category)].fetch_sub(bytes, std::memory_order_relaxed);
+    totalBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
@@ -2,20 +2,363 @@
 #include <algorithm>
 #include <unordered_set>
 #include <future>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
 
-QueryProcessor::QueryProcessor(size_t numThreads) : threadPool(numThreads) {
+namespace {
+
+// Rows per vectorized batch in processChunk
+constexpr size_t kBatchSize = 1024;
+
+// Batches between re-ranking of the scan steps
+constexpr size_t kReorderInterval = 16;
+
+enum class ScanStep : size_t {
+    SupplierFilter,
+    OrderFilter,
+    JoinProbe
+};
+
+constexpr size_t kNumScanSteps = 3;
+
+// Rows whose index slots are prefetched together by the prefetching probe
+constexpr size_t kDefaultPrefetchGroup = 16;
+constexpr size_t kMaxPrefetchGroup = 64;
+
+// Minimum rows per task when building indexes in parallel; smaller inputs
+// are built on the calling thread
+constexpr size_t kMinBuildChunk = 16384;
+
+// Relative per-row cost of each step: the supplier bitmap stays in cache,
+// the order bitmap is larger, and the probe does three hash lookups
+constexpr double kStepCost[kNumScanSteps] = {1.0, 2.0, 8.0};
+
+struct StepStats {
+    uint64_t rowsIn = 0;
+    uint64_t rowsOut = 0;
+};
+
+size_t filterBySupplier(const LineItem* batch, uint32_t* selection, size_t count, const RuntimeFilter& filter) {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t row = selection[i];
+        selection[kept] = row;
+        kept += filter.contains(batch[row].l_suppkey);
+    }
+    return kept;
+}
+
+size_t filterByOrder(const LineItem* batch, uint32_t* selection, size_t count, const RuntimeFilter& filter) {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t row = selection[i];
+        selection[kept] = row;
+        kept += filter.contains(batch[row].l_orderkey);
+    }
+    return kept;
+}
+
+// Probe the join indexes for the selected rows and call onMatch(nationKey, revenue)
+// for every row that satisfies all join predicates
+template<class OnMatch>
+size_t forEachMatch(
+    const LineItem* batch,
+    const uint32_t* selection,
+    size_t count,
+    const JoinIndexes& indexes,
+    OnMatch&& onMatch
+) {
+    size_t matched = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const auto& lineItem = batch[selection[i]];
+        
+        const int32_t* customerKey = indexes.orderToCustomer.find(lineItem.l_orderkey);
+        if (customerKey == nullptr) {
+            continue;
+        }
+        
+        const int32_t* supplierNation = indexes.supplierToNation.find(lineItem.l_suppkey);
+        if (supplierNation == nullptr) {
+            continue;
+        }
+        
+        // c_nationkey = s_nationkey
+        const int32_t* customerNation = indexes.customerToNation.find(*customerKey);
+        if (customerNation == nullptr || *customerNation != *supplierNation) {
+            continue;
+        }
+        
+        onMatch(*supplierNation, lineItem.revenue());
+        ++matched;
+    }
+    return matched;
+}
+
+// Same as forEachMatch, but resolves rows in groups: the order and supplier
+// slots of the whole group are prefetched first, then the customer slots, so
+// many cache misses are in flight at once instead of one per row
+template<class OnMatch>
+size_t forEachMatchPrefetched(
+    const LineItem* batch,
+    const uint32_t* selection,
+    size_t count,
+    const JoinIndexes& indexes,
+    size_t groupSize,
+    OnMatch&& onMatch
+) {
+    int32_t customerKeys[kMaxPrefetchGroup];
+    size_t matched = 0;
+    
+    for (size_t groupStart = 0; groupStart < count; groupStart += groupSize) {
+        const uint32_t* rows = selection + groupStart;
+        size_t groupCount = std::min(groupSize, count - groupStart);
+        
+        for (size_t i = 0; i < groupCount; ++i) {
+            const auto& lineItem = batch[rows[i]];
+            indexes.orderToCustomer.prefetch(lineItem.l_orderkey);
+            indexes.supplierToNation.prefetch(lineItem.l_suppkey);
+        }
+        
+        for (size_t i = 0; i < groupCount; ++i) {
+            const int32_t* customerKey = indexes.orderToCustomer.find(batch[rows[i]].l_orderkey);
+            customerKeys[i] = JoinHashTable::kEmptyKey;
+            if (customerKey != nullptr) {
+                customerKeys[i] = *customerKey;
+                indexes.customerToNation.prefetch(*customerKey);
+            }
+        }
+        
+        for (size_t i = 0; i < groupCount; ++i) {
+            if (customerKeys[i] == JoinHashTable::kEmptyKey) {
+                continue;
+            }
+            
+            const auto& lineItem = batch[rows[i]];
+            const int32_t* supplierNation = indexes.supplierToNation.find(lineItem.l_suppkey);
+            if (supplierNation == nullptr) {
+                continue;
+            }
+            
+            // c_nationkey = s_nationkey
+            const int32_t* customerNation = indexes.customerToNation.find(customerKeys[i]);
+            if (customerNation == nullptr || *customerNation != *supplierNation) {
+                continue;
+            }
+            
+            onMatch(*supplierNation, lineItem.revenue());
+            ++matched;
+        }
+    }
+    return matched;
+}
+
+// Probe with the selected kernel
+template<class OnMatch>
+size_t probeRows(
+    ProbeMode mode,
+    size_t groupSize,
+    const LineItem* batch,
+    const uint32_t* selection,
+    size_t count,
+    const JoinIndexes& indexes,
+    OnMatch&& onMatch
+) {
+    if (mode == ProbeMode::Prefetch) {
+        return forEachMatchPrefetched(batch, selection, count, indexes, groupSize, onMatch);
+    }
+    return forEachMatch(batch, selection, count, indexes, onMatch);
+}
+
+// Smallest sample fraction of the first round when a target error is set
+constexpr double kInitialSampleFraction = 0.005;
+
+// Upper bound on how much the first round may grow the sample, so its
+// noisy variance estimate cannot jump straight to the full table
+constexpr double kMaxSampleGrowth = 8.0;
+
+// Past this fraction another round costs about as much as the rest of the
+// table, so the sample goes straight to the sample rate
+constexpr double kFullScanFraction = 0.5;
+
+// Sampled blocks required before a block sample may stop early; intervals
+// from a handful of blocks are unreliable
+constexpr size_t kMinConvergenceBlocks = 30;
+
+// Above this per-round rate, uniform sampling tests every unsampled row
+// instead of drawing geometric skips; a skip costs a logarithm, about as
+// much as testing twenty rows
+constexpr double kDenseSampleRate = 0.05;
+
+// Seed of the random stream of one chunk in one sampling round
+uint64_t sampleSeed(uint64_t seed, uint64_t chunk, uint64_t round) {
+    uint64_t x = seed + chunk * 0xD1B54A32D192ED03ULL + round * 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Inverse of the standard normal CDF (Acklam's rational approximation)
+double normalQuantile(double p) {
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                               1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                               6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                               -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                               3.754408661907416e+00};
+    const double low = 0.02425;
+    
+    p = std::min(std::max(p, 1e-12), 1.0 - 1e-12);
+    if (p < low) {
+        double q = std::sqrt(-2.0 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    if (p > 1.0 - low) {
+        return -normalQuantile(1.0 - p);
+    }
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+}
+
+// Split [0, size) into at most one chunk per pool thread, run f(start, end)
+// on every chunk and return the results in chunk order
+template<class F>
+auto parallelChunks(ThreadPool& pool, size_t size, F&& f) -> std::vector<decltype(f(size_t(0), size_t(0)))> {
+    using Result = decltype(f(size_t(0), size_t(0)));
+    size_t numChunks = std::max<size_t>(1, std::min(pool.size(), size / kMinBuildChunk));
+    size_t chunkSize = (size + numChunks - 1) / numChunks;
+    
+    std::vector<Result> results;
+    if (numChunks == 1) {
+        results.push_back(f(size_t(0), size));
+        return results;
+    }
+    
+    std::vector<std::future<Result>> futures;
+    for (size_t start = 0; start < size; start += chunkSize) {
+        size_t end = std::min(start + chunkSize, size);
+        futures.push_back(pool.enqueue([&f, start, end] { return f(start, end); }));
+    }
+    for (auto& future : futures) {
+        results.push_back(future.get());
+    }
+    return results;
+}
+
+// Build a join index over the rows of a table that qualify. All pool threads
+// first count the qualifying rows to size the table, then insert them with
+// lock-free CAS inserts. Join keys are primary keys; if the table repeats
+// one anyway, the index is rebuilt in row order so the first row of each
+// key deterministically wins.
+template<class Table, class Qualifies, class KeyOf, class ValueOf>
+JoinHashTable buildIndexInParallel(
+    ThreadPool& pool,
+    MemoryCategory category,
+    const Table& table,
+    Qualifies qualifies,
+    KeyOf keyOf,
+    ValueOf valueOf
+) {
+    auto counts = parallelChunks(pool, table.size(), [&](size_t start, size_t end) {
+        return static_cast<size_t>(std::count_if(table.begin() + start, table.begin() + end, qualifies));
+    });
+    JoinHashTable index(category, std::accumulate(counts.begin(), counts.end(), size_t(0)));
+    
+    size_t qualifying = std::accumulate(counts.begin(), counts.end(), size_t(0));
+    auto inserted = parallelChunks(pool, table.size(), [&](size_t start, size_t end) {
+        size_t newKeys = 0;
+        for (size_t i = start; i < end; ++i) {
+            if (qualifies(table[i])) {
+                newKeys += index.insertConcurrent(keyOf(table[i]), valueOf(table[i]));
+            }
+        }
+        return newKeys;
+    });
+    size_t keys = std::accumulate(inserted.begin(), inserted.end(), size_t(0));
+    
+    if (keys < qualifying) {
+        index = JoinHashTable(category, qualifying);
+        keys = 0;
+        for (const auto& row : table) {
+            if (qualifies(row)) {
+                keys += index.insertConcurrent(keyOf(row), valueOf(row));
+            }
+        }
+        std::cerr << "Warning: " << qualifying - keys << " duplicate keys in the "
+                  << MemoryTracker::categoryName(category) << "; keeping the first row of each" << std::endl;
+    }
+    index.commitConcurrentInserts(keys);
+    return index;
+}
+
+// Build a runtime filter over the keys of a join index, with each pool
+// thread scanning a disjoint range of slots
+RuntimeFilter buildRuntimeFilter(ThreadPool& pool, const JoinHashTable& index) {
+    auto maxKeys = parallelChunks(pool, index.slotCount(), [&index](size_t first, size_t last) {
+        int32_t maxKey = -1;
+        index.forEachInSlots(first, last, [&maxKey](int32_t key, int32_t) {
+            maxKey = std::max(maxKey, key);
+        });
+        return maxKey;
+    });
+    
+    RuntimeFilter filter(*std::max_element(maxKeys.begin(), maxKeys.end()));
+    parallelChunks(pool, index.slotCount(), [&index, &filter](size_t first, size_t last) {
+        index.forEachInSlots(first, last, [&filter](int32_t key, int32_t) {
+            filter.insertConcurrent(key);
+        });
+        return 0;
+    });
+    return filter;
+}
+
+// Order steps by cost per rejected row so the cheapest, most selective check runs first
+void reorderSteps(std::array<ScanStep, kNumScanSteps>& stepOrder, const std::array<StepStats, kNumScanSteps>& stats) {
+    auto rank = [&stats](ScanStep step) {
+        size_t index = static_cast<size_t>(step);
+        double passRate = 0.0;
+        if (stats[index].rowsIn > 0) {
+            passRate = static_cast<double>(stats[index].rowsOut) / stats[index].rowsIn;
+        }
+        return kStepCost[index] / std::max(1.0 - passRate, 1e-3);
+    };
+    
+    std::stable_sort(stepOrder.begin(), stepOrder.end(), [&rank](ScanStep a, ScanStep b) {
+        return rank(a) < rank(b);
+    });
+}
+
+} // namespace
+
+QueryProcessor::QueryProcessor(size_t numThreads)
+    : threadPool(numThreads), probeMode(ProbeMode::Prefetch), prefetchGroupSize(kDefaultPrefetchGroup),
+      buildMilliseconds(-1) {
 }
 
 QueryProcessor::~QueryProcessor() {
 }
 
+void QueryProcessor::setProbeMode(ProbeMode mode, size_t groupSize) {
+    probeMode = mode;
+    prefetchGroupSize = std::min(std::max<size_t>(groupSize, 1), kMaxPrefetchGroup);
+}
+
 std::vector<QueryResult> QueryProcessor::processQuery(
-    const std::vector<Customer>& customers,
-    const std::vector<Order>& orders,
-    const std::vector<LineItem>& lineItems,
-    const std::vector<Supplier>& suppliers,
-    const std::vector<Nation>& nations,
-    const std::vector<Region>& regions
+    const CustomerTable& customers,
+    const OrderTable& orders,
+    const LineItemTable& lineItems,
+    const SupplierTable& suppliers,
+    const NationTable& nations,
+    const RegionTable& regions
 ) {
     // Check if we have valid data
     if (customers.empty() || orders.empty() || lineItems.empty() || 
@@ -24,10 +367,19 @@ std::vector<QueryResult> QueryProcessor::processQuery(
     }
     
     // Build indexes for efficient joins
-    auto orderToCustomer = buildOrderToCustomerIndex(orders);
-    auto supplierToNation = buildSupplierToNationIndex(suppliers);
-    auto validCustomerNations = buildValidCustomerNationsIndex(customers, suppliers);
-    auto nationNameIndex = buildNationNameIndex(nations);
+    MemoryTracker::beginPhase("build");
+    auto indexes = buildJoinIndexes(customers, orders, suppliers, nations, regions);
+    return processQuery(lineItems, indexes);
+}
+
+std::vector<QueryResult> QueryProcessor::processQuery(
+    const LineItemTable& lineItems,
+    const JoinIndexes& indexes
+) {
+    if (lineItems.empty()) {
+        return {};
+    }
+    MemoryTracker::beginPhase("probe");
     
     // Determine the number of threads and chunk size
     size_t numThreads = threadPool.size();
@@ -50,9 +402,7 @@ std::vector<QueryResult> QueryProcessor::processQuery(
                 std::ref(lineItems),
                 start,
                 end,
-                std::ref(orderToCustomer),
-                std::ref(supplierToNation),
-                std::ref(validCustomerNations)
+                std::ref(indexes)
             )
         );
     }
@@ -69,8 +419,9 @@ std::vector<QueryResult> QueryProcessor::processQuery(
     // Convert to result format and sort
     std::vector<QueryResult> results;
     for (const auto& [nationKey, revenue] : nationRevenues) {
-        if (nationNameIndex.find(nationKey) != nationNameIndex.end()) {
-            results.emplace_back(nationNameIndex[nationKey], revenue);
+        auto nameIt = indexes.nationNames.find(nationKey);
+        if (nameIt != indexes.nationNames.end()) {
+            results.emplace_back(nameIt->second, revenue);
         }
     }
     
@@ -81,85 +432,705 @@ std::vector<QueryResult> QueryProcessor::processQuery(
 }
 
 std::unordered_map<int32_t, double> QueryProcessor::processChunk(
-    const std::vector<LineItem>& lineItems,
+    const LineItemTable& lineItems,
     size_t start,
     size_t end,
-    const std::unordered_map<int32_t, int32_t>& orderToCustomer,
-    const std::unordered_map<int32_t, int32_t>& supplierToNation,
-    const std::unordered_map<int32_t, bool>& validCustomerNations
+    const JoinIndexes& indexes
 ) {
     std::unordered_map<int32_t, double> nationRevenues;
     
-    for (size_t i = start; i < end; ++i) {
-        const auto& lineItem = lineItems[i];
+    // Steps start in order of estimated cost and are re-ranked periodically
+    // from the pass rates observed in this chunk
+    std::array<ScanStep, kNumScanSteps> stepOrder = {
+        ScanStep::SupplierFilter, ScanStep::OrderFilter, ScanStep::JoinProbe
+    };
+    std::array<StepStats, kNumScanSteps> stats{};
+    std::vector<uint32_t> selection(kBatchSize);
+    size_t batchCount = 0;
+    
+    for (size_t batchStart = start; batchStart < end; batchStart += kBatchSize) {
+        size_t batchEnd = std::min(batchStart + kBatchSize, end);
+        size_t count = batchEnd - batchStart;
+        const LineItem* batch = lineItems.data() + batchStart;
         
-        // Check if this line item's order exists in our filtered orders
-        auto orderIt = orderToCustomer.find(lineItem.l_orderkey);
-        if (orderIt == orderToCustomer.end()) {
-            continue;
+        for (size_t i = 0; i < count; ++i) {
+            selection[i] = static_cast<uint32_t>(i);
         }
         
-        int32_t custkey = orderIt->second;
+        for (ScanStep step : stepOrder) {
+            size_t rowsIn = count;
+            
+            switch (step) {
+                case ScanStep::SupplierFilter:
+                    count = filterBySupplier(batch, selection.data(), count, indexes.supplierFilter);
+                    break;
+                case ScanStep::OrderFilter:
+                    count = filterByOrder(batch, selection.data(), count, indexes.orderFilter);
+                    break;
+                case ScanStep::JoinProbe:
+                    count = probeRows(probeMode, prefetchGroupSize, batch, selection.data(), count, indexes,
+                                      [&nationRevenues](int32_t nationKey, double revenue) {
+                                          nationRevenues[nationKey] += revenue;
+                                      });
+                    break;
+            }
+            
+            auto& stepStats = stats[static_cast<size_t>(step)];
+            stepStats.rowsIn += rowsIn;
+            stepStats.rowsOut += count;
+            
+            // The probe checks every predicate, so filters after it are redundant
+            if (step == ScanStep::JoinProbe || count == 0) {
+                break;
+            }
+        }
         
-        // Check if this line item's supplier exists and get its nation
-        auto supplierIt = supplierToNation.find(lineItem.l_suppkey);
-        if (supplierIt == supplierToNation.end()) {
-            continue;
+        if (++batchCount % kReorderInterval == 0) {
+            reorderSteps(stepOrder, stats);
+        }
+    }
+    
+    return nationRevenues;
+}
+
+ApproxSummary QueryProcessor::processApproxQuery(
+    const CustomerTable& customers,
+    const OrderTable& orders,
+    const LineItemTable& lineItems,
+    const SupplierTable& suppliers,
+    const NationTable& nations,
+    const RegionTable& regions,
+    const ApproxOptions& options
+) {
+    ApproxSummary summary;
+    
+    // Check if we have valid data
+    if (customers.empty() || orders.empty() || lineItems.empty() || 
+        suppliers.empty() || nations.empty() || regions.empty()) {
+        return summary;
+    }
+    
+    // Build indexes for efficient joins
+    MemoryTracker::beginPhase("build");
+    auto indexes = buildJoinIndexes(customers, orders, suppliers, nations, regions);
+    return processApproxQuery(lineItems, indexes, options);
+}
+
+ApproxSummary QueryProcessor::processApproxQuery(
+    const LineItemTable& lineItems,
+    const JoinIndexes& indexes,
+    const ApproxOptions& options
+) {
+    ApproxSummary summary;
+    if (lineItems.empty()) {
+        return summary;
+    }
+    MemoryTracker::beginPhase("probe");
+    
+    size_t numThreads = threadPool.size();
+    bool blockSampling = options.method == SamplingMethod::Block;
+    double maxFraction = std::min(std::max(options.sampleRate, 0.0), 1.0);
+    double z = normalQuantile(0.5 + options.confidence / 2.0);
+    
+    // Full blocks are the sampling units and are visited in a random order,
+    // so every prefix is a simple random sample. A partial last block would
+    // count as much as a full one, so it is scanned exactly instead.
+    size_t blockSize = std::max<size_t>(options.blockSize, 1);
+    size_t numBlocks = lineItems.size() / blockSize;
+    size_t tailStart = numBlocks * blockSize;
+    std::vector<size_t> blockOrder;
+    if (blockSampling) {
+        blockOrder.resize(numBlocks);
+        for (size_t i = 0; i < numBlocks; ++i) {
+            blockOrder[i] = i;
         }
+        std::mt19937_64 rng(options.seed);
+        std::shuffle(blockOrder.begin(), blockOrder.end(), rng);
+    }
+    
+    // Every nation with a supplier in the region can be in the result, so
+    // each one gets an estimate even while the sample misses it
+    SampleAccumulator total;
+    indexes.supplierToNation.forEach([&total](int32_t, int32_t nationKey) {
+        total.nations[nationKey];
+    });
+    std::unordered_map<int32_t, double> tailRevenues;
+    if (blockSampling && tailStart < lineItems.size()) {
+        tailRevenues = processChunk(lineItems, tailStart, lineItems.size(), indexes);
+        total.rows += lineItems.size() - tailStart;
+        for (const auto& entry : tailRevenues) {
+            total.nations[entry.first];
+        }
+    }
+    
+    // Rows sampled so far by each chunk in uniform sampling, kept sorted
+    size_t chunkSize = (lineItems.size() + numThreads - 1) / numThreads;
+    std::vector<std::vector<uint32_t>> chunkSamples;
+    if (!blockSampling) {
+        chunkSamples.resize((lineItems.size() + chunkSize - 1) / chunkSize);
+    }
+    
+    size_t sampledBlocks = 0;
+    double sampledFraction = 0.0;
+    double fraction = maxFraction;
+    if (options.targetError > 0.0) {
+        fraction = std::min(maxFraction, kInitialSampleFraction);
+    }
+    
+    while (true) {
+        std::vector<std::future<SampleAccumulator>> futures;
         
-        int32_t nationkey = supplierIt->second;
+        if (blockSampling) {
+            // At least two blocks are needed to estimate the variance
+            size_t targetBlocks = static_cast<size_t>(std::ceil(fraction * numBlocks));
+            targetBlocks = std::min(numBlocks, std::max({targetBlocks, sampledBlocks + 1, size_t(2)}));
+            size_t perThread = (targetBlocks - sampledBlocks + numThreads - 1) / numThreads;
+            
+            for (size_t first = sampledBlocks; first < targetBlocks; first += perThread) {
+                futures.push_back(
+                    threadPool.enqueue(
+                        &QueryProcessor::sampleBlocks,
+                        this,
+                        std::ref(lineItems),
+                        std::ref(blockOrder),
+                        first,
+                        std::min(first + perThread, targetBlocks),
+                        blockSize,
+                        std::ref(indexes)
+                    )
+                );
+            }
+            sampledBlocks = targetBlocks;
+        } else if (fraction >= 1.0) {
+            // Every row is in the sample, so scan exactly instead of topping
+            // the sample up row by row
+            std::vector<std::future<std::unordered_map<int32_t, double>>> exactFutures;
+            for (size_t start = 0; start < lineItems.size(); start += chunkSize) {
+                exactFutures.push_back(
+                    threadPool.enqueue(
+                        &QueryProcessor::processChunk,
+                        this,
+                        std::ref(lineItems),
+                        start,
+                        std::min(start + chunkSize, lineItems.size()),
+                        std::ref(indexes)
+                    )
+                );
+            }
+            
+            std::vector<std::unordered_map<int32_t, double>> partialResults;
+            for (auto& future : exactFutures) {
+                partialResults.push_back(future.get());
+            }
+            total = SampleAccumulator();
+            total.rows = lineItems.size();
+            for (const auto& [nationKey, revenue] : mergeResults(partialResults)) {
+                total.nations[nationKey].sum = revenue;
+                total.nations[nationKey].count = 1;
+            }
+        } else {
+            // Each round adds every unsampled row with the probability that
+            // raises the inclusion probability from sampledFraction to fraction
+            double rate = (fraction - sampledFraction) / (1.0 - sampledFraction);
+            for (size_t chunk = 0; chunk < chunkSamples.size(); ++chunk) {
+                size_t start = chunk * chunkSize;
+                futures.push_back(
+                    threadPool.enqueue(
+                        &QueryProcessor::sampleRows,
+                        this,
+                        std::ref(lineItems),
+                        start,
+                        std::min(start + chunkSize, lineItems.size()),
+                        rate,
+                        sampleSeed(options.seed, chunk, summary.rounds),
+                        std::ref(chunkSamples[chunk]),
+                        std::ref(indexes)
+                    )
+                );
+            }
+        }
         
-        // Check if customer and supplier are from the same nation
-        // and if that nation is in the specified region
-        auto validIt = validCustomerNations.find(custkey);
-        if (validIt == validCustomerNations.end() || !validIt->second) {
-            continue;
+        // Merge the per-thread sample statistics
+        for (auto& future : futures) {
+            auto partial = future.get();
+            total.rows += partial.rows;
+            for (const auto& [nationKey, moments] : partial.nations) {
+                auto& merged = total.nations[nationKey];
+                merged.sum += moments.sum;
+                merged.sumSquares += moments.sumSquares;
+                merged.count += moments.count;
+                merged.maxValue = std::max(merged.maxValue, moments.maxValue);
+            }
+        }
+        sampledFraction = fraction;
+        ++summary.rounds;
+        
+        // Scale the sample to the full table and compute the interval per nation
+        summary.results.clear();
+        bool converged = options.targetError > 0.0;
+        double worstRatio = 0.0;
+        if (blockSampling && sampledBlocks < std::min(numBlocks, kMinConvergenceBlocks)) {
+            converged = false;
+        }
+        bool complete = blockSampling ? sampledBlocks == numBlocks : sampledFraction >= 1.0;
+        double maxUnitValue = 0.0;
+        for (const auto& entry : total.nations) {
+            maxUnitValue = std::max(maxUnitValue, entry.second.maxValue);
+        }
+        for (const auto& [nationKey, moments] : total.nations) {
+            auto nameIt = indexes.nationNames.find(nationKey);
+            if (nameIt == indexes.nationNames.end()) {
+                continue;
+            }
+            
+            double estimate = 0.0;
+            double variance = 0.0;
+            if (blockSampling) {
+                // Cluster sampling without replacement over full block
+                // totals, plus the exactly scanned partial block
+                auto tailIt = tailRevenues.find(nationKey);
+                estimate = tailIt != tailRevenues.end() ? tailIt->second : 0.0;
+                if (sampledBlocks > 0) {
+                    double n = static_cast<double>(sampledBlocks);
+                    double N = static_cast<double>(numBlocks);
+                    double mean = moments.sum / n;
+                    double blockVariance = 0.0;
+                    if (sampledBlocks > 1) {
+                        blockVariance = std::max(0.0, (moments.sumSquares - n * mean * mean) / (n - 1.0));
+                    }
+                    estimate += N * mean;
+                    variance = N * N * (1.0 - n / N) * blockVariance / n;
+                }
+            } else {
+                // Horvitz-Thompson estimator for Bernoulli sampling
+                double p = sampledFraction;
+                estimate = moments.sum / p;
+                variance = (1.0 - p) / (p * p) * moments.sumSquares;
+            }
+            
+            if (moments.count == 0 && complete && estimate == 0.0) {
+                // Scanned in full without a hit; absent, as in the exact result
+                continue;
+            }
+            if (moments.count == 0 && !complete) {
+                // The sample missed this nation, so it has no variance to go
+                // by. Bound the units holding it that the sample could have
+                // missed at this confidence, each worth at most the largest
+                // unit sampled so far.
+                double inclusion = sampledFraction;
+                double units = static_cast<double>(lineItems.size());
+                if (blockSampling) {
+                    inclusion = static_cast<double>(sampledBlocks) / std::max<size_t>(numBlocks, 1);
+                    units = static_cast<double>(numBlocks);
+                }
+                double missedUnits = std::min((1.0 - inclusion) * units,
+                                              std::log(1.0 - options.confidence) / std::log1p(-inclusion));
+                double upper = maxUnitValue > 0.0 ? estimate + missedUnits * maxUnitValue
+                                                  : std::numeric_limits<double>::infinity();
+                summary.results.emplace_back(nameIt->second, estimate, estimate, upper);
+                converged = false;
+                continue;
+            }
+            
+            double halfWidth = z * std::sqrt(variance);
+            summary.results.emplace_back(nameIt->second, estimate, estimate - halfWidth, estimate + halfWidth);
+            if (halfWidth > options.targetError * std::abs(estimate)) {
+                converged = false;
+            }
+            worstRatio = std::max(worstRatio, halfWidth / std::max(options.targetError * std::abs(estimate), 1e-9));
         }
         
-        // Calculate revenue and add to the nation's total
-        double revenue = lineItem.revenue();
-        nationRevenues[nationkey] += revenue;
+        if (converged && !summary.results.empty()) {
+            summary.converged = true;
+            break;
+        }
+        if (fraction >= maxFraction || (blockSampling && sampledBlocks == numBlocks)) {
+            break;
+        }
+        
+        // Interval width shrinks with the square root of the sample size, so
+        // grow the sample by the square of the widest interval's excess. The
+        // first round's variance is too noisy to trust without a bound.
+        double needed = fraction * std::max(2.0, 1.2 * worstRatio * worstRatio);
+        if (summary.rounds == 1) {
+            needed = std::min(needed, fraction * kMaxSampleGrowth);
+        }
+        fraction = needed > kFullScanFraction ? maxFraction : std::min(maxFraction, needed);
     }
     
-    return nationRevenues;
+    summary.sampledRows = total.rows;
+    std::sort(summary.results.begin(), summary.results.end());
+    
+    return summary;
+}
+
+SampleAccumulator QueryProcessor::sampleBlocks(
+    const LineItemTable& lineItems,
+    const std::vector<size_t>& blockOrder,
+    size_t first,
+    size_t last,
+    size_t blockSize,
+    const JoinIndexes& indexes
+) {
+    SampleAccumulator accumulator;
+    
+    for (size_t i = first; i < last; ++i) {
+        size_t start = blockOrder[i] * blockSize;
+        size_t end = std::min(start + blockSize, lineItems.size());
+        
+        // Block totals are the sampling units
+        auto blockRevenues = processChunk(lineItems, start, end, indexes);
+        for (const auto& [nationKey, revenue] : blockRevenues) {
+            auto& moments = accumulator.nations[nationKey];
+            moments.sum += revenue;
+            moments.sumSquares += revenue * revenue;
+            ++moments.count;
+            moments.maxValue = std::max(moments.maxValue, revenue);
+        }
+        accumulator.rows += end - start;
+    }
+    
+    return accumulator;
+}
+
+SampleAccumulator QueryProcessor::sampleRows(
+    const LineItemTable& lineItems,
+    size_t start,
+    size_t end,
+    double rate,
+    uint64_t seed,
+    std::vector<uint32_t>& sampled,
+    const JoinIndexes& indexes
+) {
+    SampleAccumulator accumulator;
+    const LineItem* chunk = lineItems.data() + start;
+    size_t chunkRows = end - start;
+    
+    // Sparse rounds draw the new rows with geometric skips over the rows not
+    // sampled yet, so they cost time proportional to their sample; dense
+    // rounds test every unsampled row without branching
+    std::vector<uint32_t> added;
+    if (rate > kDenseSampleRate) {
+        uint64_t threshold = rate >= 1.0 ? UINT64_MAX : static_cast<uint64_t>(rate * 0x1.0p64);
+        added.resize(chunkRows);
+        size_t count = 0;
+        size_t previous = 0;
+        for (size_t row = 0; row < chunkRows; ++row) {
+            size_t next = previous < sampled.size() ? sampled[previous] : chunkRows;
+            bool taken = next == row;
+            previous += taken;
+            added[count] = static_cast<uint32_t>(row);
+            count += !taken & (sampleSeed(seed, row, 0) <= threshold);
+        }
+        added.resize(count);
+    } else if (rate > 0.0) {
+        double logKeep = std::log1p(-rate);
+        size_t rank = 0;        // Position of the next candidate among unsampled rows
+        size_t previous = 0;    // Rows of sampled before the candidate
+        
+        for (uint64_t draw = 0;; ++draw) {
+            double uniform = static_cast<double>(sampleSeed(seed, draw, 1) >> 11) * 0x1.0p-53;
+            double skip = std::floor(std::log1p(-uniform) / logKeep);
+            if (skip >= static_cast<double>(chunkRows)) {
+                break;
+            }
+            rank += static_cast<size_t>(skip);
+            
+            size_t row = rank + previous;
+            while (previous < sampled.size() && sampled[previous] <= row) {
+                ++previous;
+                ++row;
+            }
+            if (row >= chunkRows) {
+                break;
+            }
+            added.push_back(static_cast<uint32_t>(row));
+            ++rank;
+        }
+    }
+    accumulator.rows = added.size();
+    
+    std::vector<uint32_t> selection(kBatchSize);
+    for (size_t first = 0; first < added.size(); first += kBatchSize) {
+        size_t count = std::min(kBatchSize, added.size() - first);
+        std::copy(added.begin() + first, added.begin() + first + count, selection.begin());
+        
+        count = filterBySupplier(chunk, selection.data(), count, indexes.supplierFilter);
+        count = filterByOrder(chunk, selection.data(), count, indexes.orderFilter);
+        probeRows(probeMode, prefetchGroupSize, chunk, selection.data(), count, indexes,
+                  [&accumulator](int32_t nationKey, double revenue) {
+                      auto& moments = accumulator.nations[nationKey];
+                      moments.sum += revenue;
+                      moments.sumSquares += revenue * revenue;
+                      ++moments.count;
+                      moments.maxValue = std::max(moments.maxValue, revenue);
+                  });
+    }
+    
+    // Keep the sample sorted for the next round
+    std::vector<uint32_t> merged(sampled.size() + added.size());
+    std::merge(sampled.begin(), sampled.end(), added.begin(), added.end(), merged.begin());
+    sampled.swap(merged);
+    
+    return accumulator;
+}
+
+std::vector<std::vector<QueryResult>> QueryProcessor::processBatch(
+    const CustomerTable& customers,
+    const OrderTable& orders,
+    const LineItemTable& lineItems,
+    const SupplierTable& suppliers,
+    const NationTable& nations,
+    const RegionTable& regions,
+    const std::vector<QueryParameters>& queries
+) {
+    std::vector<std::vector<QueryResult>> results;
+    results.reserve(queries.size());
+    
+    // Each group of up to kMaxBatchQueries queries shares one scan
+    for (size_t first = 0; first < queries.size(); first += kMaxBatchQueries) {
+        size_t last = std::min(first + kMaxBatchQueries, queries.size());
+        std::vector<QueryParameters> group(queries.begin() + first, queries.begin() + last);
+        
+        auto groupResults = processBatchGroup(customers, orders, lineItems, suppliers, nations, regions, group);
+        for (auto& result : groupResults) {
+            results.push_back(std::move(result));
+        }
+    }
+    
+    return results;
 }
 
-std::unordered_map<int32_t, int32_t> QueryProcessor::buildOrderToCustomerIndex(const std::vector<Order>& orders) {
-    std::unordered_map<int32_t, int32_t> orderToCustomer;
-    for (const auto& order : orders) {
-        orderToCustomer[order.o_orderkey] = order.o_custkey;
+std::vector<std::vector<QueryResult>> QueryProcessor::processBatchGroup(
+    const CustomerTable& customers,
+    const OrderTable& orders,
+    const LineItemTable& lineItems,
+    const SupplierTable& suppliers,
+    const NationTable& nations,
+    const RegionTable& regions,
+    const std::vector<QueryParameters>& queries
+) {
+    std::vector<std::vector<QueryResult>> results(queries.size());
+    
+    // Check if we have valid data
+    if (customers.empty() || orders.empty() || lineItems.empty() || 
+        suppliers.empty() || nations.empty() || regions.empty()) {
+        return results;
+    }
+    
+    // Join once for the whole group
+    MemoryTracker::beginPhase("build");
+    auto indexes = buildBatchJoinIndexes(customers, orders, suppliers, nations, regions, queries);
+    auto nationNameIndex = buildNationNameIndex(nations);
+    size_t numNations = indexes.nationMasks.size();
+    MemoryTracker::beginPhase("probe");
+    
+    // Determine the number of threads and chunk size
+    size_t numThreads = threadPool.size();
+    size_t chunkSize = (lineItems.size() + numThreads - 1) / numThreads;
+    
+    // Process data in parallel
+    std::vector<std::future<BatchAccumulators>> futures;
+    for (size_t i = 0; i < numThreads; ++i) {
+        size_t start = i * chunkSize;
+        size_t end = std::min(start + chunkSize, lineItems.size());
+        
+        if (start >= lineItems.size()) {
+            break;
+        }
+        
+        futures.push_back(
+            threadPool.enqueue(
+                &QueryProcessor::processBatchChunk,
+                this,
+                std::ref(lineItems),
+                start,
+                end,
+                std::ref(indexes),
+                queries.size()
+            )
+        );
+    }
+    
+    // Merge the per-thread accumulators
+    BatchAccumulators totals;
+    totals.revenues.assign(queries.size() * numNations, 0.0);
+    totals.matches.assign(queries.size() * numNations, 0);
+    for (auto& future : futures) {
+        auto partial = future.get();
+        for (size_t i = 0; i < totals.revenues.size(); ++i) {
+            totals.revenues[i] += partial.revenues[i];
+            totals.matches[i] += partial.matches[i];
+        }
+    }
+    
+    // Convert to result format and sort, one list per query
+    for (size_t query = 0; query < queries.size(); ++query) {
+        for (size_t nationKey = 0; nationKey < numNations; ++nationKey) {
+            size_t slot = query * numNations + nationKey;
+            auto nameIt = nationNameIndex.find(static_cast<int32_t>(nationKey));
+            if (totals.matches[slot] > 0 && nameIt != nationNameIndex.end()) {
+                results[query].emplace_back(nameIt->second, totals.revenues[slot]);
+            }
+        }
+        std::sort(results[query].begin(), results[query].end());
     }
-    return orderToCustomer;
+    
+    return results;
 }
 
-std::unordered_map<int32_t, int32_t> QueryProcessor::buildSupplierToNationIndex(const std::vector<Supplier>& suppliers) {
-    std::unordered_map<int32_t, int32_t> supplierToNation;
-    for (const auto& supplier : suppliers) {
-        supplierToNation[supplier.s_suppkey] = supplier.s_nationkey;
+BatchAccumulators QueryProcessor::processBatchChunk(
+    const LineItemTable& lineItems,
+    size_t start,
+    size_t end,
+    const BatchJoinIndexes& indexes,
+    size_t numQueries
+) {
+    size_t numNations = indexes.nationMasks.size();
+    BatchAccumulators accumulators;
+    accumulators.revenues.assign(numQueries * numNations, 0.0);
+    accumulators.matches.assign(numQueries * numNations, 0);
+    
+    std::vector<uint32_t> selection(kBatchSize);
+    
+    for (size_t batchStart = start; batchStart < end; batchStart += kBatchSize) {
+        size_t batchEnd = std::min(batchStart + kBatchSize, end);
+        size_t count = batchEnd - batchStart;
+        const LineItem* batch = lineItems.data() + batchStart;
+        
+        for (size_t i = 0; i < count; ++i) {
+            selection[i] = static_cast<uint32_t>(i);
+        }
+        
+        // The union of all queries is far less selective than a single one,
+        // so the cheap filters always run first here
+        count = filterBySupplier(batch, selection.data(), count, indexes.supplierFilter);
+        count = filterByOrder(batch, selection.data(), count, indexes.orderFilter);
+        
+        for (size_t i = 0; i < count; ++i) {
+            const auto& lineItem = batch[selection[i]];
+            
+            const int32_t* orderEntry = indexes.orderToEntry.find(lineItem.l_orderkey);
+            if (orderEntry == nullptr) {
+                continue;
+            }
+            const BatchOrderEntry& order = indexes.orderEntries[*orderEntry];
+            
+            const int32_t* supplierNation = indexes.supplierToNation.find(lineItem.l_suppkey);
+            if (supplierNation == nullptr) {
+                continue;
+            }
+            
+            // c_nationkey = s_nationkey
+            int32_t nationKey = *supplierNation;
+            if (order.customerNation != nationKey) {
+                continue;
+            }
+            
+            // Queries matching both the order date and the nation's region
+            QueryMask mask = order.queries & indexes.nationMasks[nationKey];
+            double revenue = lineItem.revenue();
+            while (mask != 0) {
+                size_t slot = static_cast<size_t>(__builtin_ctzll(mask)) * numNations + nationKey;
+                accumulators.revenues[slot] += revenue;
+                ++accumulators.matches[slot];
+                mask &= mask - 1;
+            }
+        }
     }
-    return supplierToNation;
+    
+    return accumulators;
+}
+
+JoinIndexes QueryProcessor::buildJoinIndexes(
+    const CustomerTable& customers,
+    const OrderTable& orders,
+    const SupplierTable& suppliers,
+    const NationTable& nations,
+    const RegionTable& regions
+) {
+    auto buildStart = std::chrono::steady_clock::now();
+    
+    // Region qualification is applied on the build side so the probe only
+    // sees suppliers, customers and orders that can contribute to the result
+    auto regionNations = buildRegionNationSet(nations, regions);
+    JoinIndexes indexes;
+    indexes.supplierToNation = buildSupplierToNationIndex(suppliers, regionNations);
+    indexes.customerToNation = buildCustomerToNationIndex(customers, regionNations);
+    indexes.orderToCustomer = buildOrderToCustomerIndex(orders, indexes.customerToNation);
+    indexes.supplierFilter = buildRuntimeFilter(threadPool, indexes.supplierToNation);
+    indexes.orderFilter = buildRuntimeFilter(threadPool, indexes.orderToCustomer);
+    indexes.nationNames = buildNationNameIndex(nations);
+    
+    buildMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - buildStart).count();
+    return indexes;
+}
+
+int64_t QueryProcessor::lastBuildMilliseconds() const {
+    return buildMilliseconds;
 }
 
-std::unordered_map<int32_t, bool> QueryProcessor::buildValidCustomerNationsIndex(
-    const std::vector<Customer>& customers,
-    const std::vector<Supplier>& suppliers
+std::unordered_set<int32_t> QueryProcessor::buildRegionNationSet(
+    const NationTable& nations,
+    const RegionTable& regions
 ) {
-    // First, build a set of valid nation keys (nations that have suppliers)
-    std::unordered_set<int32_t> validNations;
-    for (const auto& supplier : suppliers) {
-        validNations.insert(supplier.s_nationkey);
+    std::unordered_set<int32_t> regionKeys;
+    for (const auto& region : regions) {
+        regionKeys.insert(region.r_regionkey);
     }
     
-    // Then, mark customers from those nations
-    std::unordered_map<int32_t, bool> validCustomers;
-    for (const auto& customer : customers) {
-        validCustomers[customer.c_custkey] = (validNations.find(customer.c_nationkey) != validNations.end());
+    std::unordered_set<int32_t> regionNations;
+    for (const auto& nation : nations) {
+        if (regionKeys.find(nation.n_regionkey) != regionKeys.end()) {
+            regionNations.insert(nation.n_nationkey);
+        }
     }
     
-    return validCustomers;
+    return regionNations;
+}
+
+JoinHashTable QueryProcessor::buildSupplierToNationIndex(
+    const SupplierTable& suppliers,
+    const std::unordered_set<int32_t>& regionNations
+) {
+    auto inRegion = [&regionNations](const Supplier& supplier) {
+        return regionNations.find(supplier.s_nationkey) != regionNations.end();
+    };
+    
+    return buildIndexInParallel(threadPool, MemoryCategory::SupplierIndex, suppliers, inRegion,
+                                [](const Supplier& supplier) { return supplier.s_suppkey; },
+                                [](const Supplier& supplier) { return supplier.s_nationkey; });
 }
 
-std::unordered_map<int32_t, std::string> QueryProcessor::buildNationNameIndex(const std::vector<Nation>& nations) {
+JoinHashTable QueryProcessor::buildCustomerToNationIndex(
+    const CustomerTable& customers,
+    const std::unordered_set<int32_t>& regionNations
+) {
+    auto inRegion = [&regionNations](const Customer& customer) {
+        return regionNations.find(customer.c_nationkey) != regionNations.end();
+    };
+    
+    return buildIndexInParallel(threadPool, MemoryCategory::CustomerIndex, customers, inRegion,
+                                [](const Customer& customer) { return customer.c_custkey; },
+                                [](const Customer& customer) { return customer.c_nationkey; });
+}
+
+JoinHashTable QueryProcessor::buildOrderToCustomerIndex(
+    const OrderTable& orders,
+    const JoinHashTable& customerToNation
+) {
+    // Orders placed by customers outside the region can never match
+    auto qualifies = [&customerToNation](const Order& order) {
+        return customerToNation.find(order.o_custkey) != nullptr;
+    };
+    
+    return buildIndexInParallel(threadPool, MemoryCategory::OrderIndex, orders, qualifies,
+                                [](const Order& order) { return order.o_orderkey; },
+                                [](const Order& order) { return order.o_custkey; });
+}
+
+std::unordered_map<int32_t, std::string> QueryProcessor::buildNationNameIndex(const NationTable& nations) {
     std::unordered_map<int32_t, std::string> nationNames;
     for (const auto& nation : nations) {
         nationNames[nation.n_nationkey] = nation.n_name;
@@ -167,6 +1138,112 @@ std::unordered_map<int32_t, std::string> QueryProcessor::buildNationNameIndex(co
     return nationNames;
 }
 
+BatchJoinIndexes QueryProcessor::buildBatchJoinIndexes(
+    const CustomerTable& customers,
+    const OrderTable& orders,
+    const SupplierTable& suppliers,
+    const NationTable& nations,
+    const RegionTable& regions,
+    const std::vector<QueryParameters>& queries
+) {
+    BatchJoinIndexes indexes;
+    
+    // Map each nation to the queries whose region contains it
+    std::unordered_map<int32_t, QueryMask> regionMasks;
+    for (const auto& region : regions) {
+        QueryMask mask = 0;
+        for (size_t query = 0; query < queries.size(); ++query) {
+            if (queries[query].regionName == region.r_name) {
+                mask |= QueryMask(1) << query;
+            }
+        }
+        regionMasks[region.r_regionkey] |= mask;
+    }
+    
+    int32_t maxNationKey = -1;
+    for (const auto& nation : nations) {
+        maxNationKey = std::max(maxNationKey, nation.n_nationkey);
+    }
+    indexes.nationMasks.assign(static_cast<size_t>(maxNationKey + 1), 0);
+    for (const auto& nation : nations) {
+        auto regionIt = regionMasks.find(nation.n_regionkey);
+        if (nation.n_nationkey >= 0 && regionIt != regionMasks.end()) {
+            indexes.nationMasks[nation.n_nationkey] = regionIt->second;
+        }
+    }
+    
+    // Suppliers and customers in a region named by at least one query
+    std::unordered_set<int32_t> regionNations;
+    for (size_t nationKey = 0; nationKey < indexes.nationMasks.size(); ++nationKey) {
+        if (indexes.nationMasks[nationKey] != 0) {
+            regionNations.insert(static_cast<int32_t>(nationKey));
+        }
+    }
+    indexes.supplierToNation = buildSupplierToNationIndex(suppliers, regionNations);
+    auto customerToNation = buildCustomerToNationIndex(customers, regionNations);
+    
+    // Queries each order qualifies for by date and customer region, with
+    // every pool thread taking a chunk of orders
+    TrackedVector<QueryMask, MemoryCategory::OrderIndex> orderMasks(orders.size());
+    auto chunkCounts = parallelChunks(threadPool, orders.size(), [&](size_t start, size_t end) {
+        size_t count = 0;
+        for (size_t i = start; i < end; ++i) {
+            const int32_t* customerNation = customerToNation.find(orders[i].o_custkey);
+            QueryMask mask = 0;
+            if (customerNation != nullptr) {
+                for (size_t query = 0; query < queries.size(); ++query) {
+                    if (orders[i].o_orderdate >= queries[query].dateFrom &&
+                        orders[i].o_orderdate < queries[query].dateTo) {
+                        mask |= QueryMask(1) << query;
+                    }
+                }
+                mask &= indexes.nationMasks[*customerNation];
+            }
+            orderMasks[i] = mask;
+            count += mask != 0;
+        }
+        return std::make_pair(start, count);
+    });
+    
+    // Qualifying orders are stored densely in row order; each chunk writes
+    // its own range, starting after the orders of the chunks before it
+    std::vector<size_t> chunkOffsets(chunkCounts.size() + 1, 0);
+    for (size_t chunk = 0; chunk < chunkCounts.size(); ++chunk) {
+        chunkOffsets[chunk + 1] = chunkOffsets[chunk] + chunkCounts[chunk].second;
+    }
+    indexes.orderEntries.resize(chunkOffsets.back());
+    TrackedVector<int32_t, MemoryCategory::OrderIndex> entryOf(orders.size());
+    parallelChunks(threadPool, orders.size(), [&](size_t start, size_t end) {
+        auto chunk = std::find_if(chunkCounts.begin(), chunkCounts.end(), [start](const auto& counted) {
+            return counted.first == start;
+        });
+        size_t entry = chunkOffsets[chunk - chunkCounts.begin()];
+        for (size_t i = start; i < end; ++i) {
+            entryOf[i] = -1;
+            if (orderMasks[i] != 0) {
+                indexes.orderEntries[entry] = BatchOrderEntry{*customerToNation.find(orders[i].o_custkey), orderMasks[i]};
+                entryOf[i] = static_cast<int32_t>(entry++);
+            }
+        }
+        return 0;
+    });
+    
+    auto row = [&orders](const Order& order) {
+        return static_cast<size_t>(&order - orders.data());
+    };
+    indexes.orderToEntry = buildIndexInParallel(
+        threadPool, MemoryCategory::OrderIndex, orders,
+        [&](const Order& order) { return entryOf[row(order)] >= 0; },
+        [](const Order& order) { return order.o_orderkey; },
+        [&](const Order& order) { return entryOf[row(order)]; }
+    );
+    
+    indexes.supplierFilter = buildRuntimeFilter(threadPool, indexes.supplierToNation);
+    indexes.orderFilter = buildRuntimeFilter(threadPool, indexes.orderToEntry);
+    
+    return indexes;
+}
+
 std::unordered_map<int32_t, double> QueryProcessor::mergeResults(
     const std::vector<std::unordered_map<int32_t, double>>& partialResults
 ) {
@@ -0,0 +1,49 @@
+#include "../include/runtime_filter.h"
+
+RuntimeFilter::RuntimeFilter() : words(nullptr), numKeys(0) {
+}
+
+RuntimeFilter::RuntimeFilter(int32_t maxKey) : words(nullptr), numKeys(0) {
+    if (maxKey >= 0) {
+        numKeys = static_cast<uint32_t>(maxKey) + 1;
+        bits.assign((numKeys + 63) / 64, 0);
+        words = bits.data();
+    }
+}
+
+RuntimeFilter::RuntimeFilter(const uint64_t* words, uint32_t numKeys) : words(words), numKeys(numKeys) {
+}
+
+void RuntimeFilter::insert(int32_t key) {
+    uint32_t k = static_cast<uint32_t>(key);
+    if (k < numKeys) {
+        bits[k >> 6] |= uint64_t(1) << (k & 63);
+    }
+}
+
+void RuntimeFilter::insertConcurrent(int32_t key) {
+    uint32_t k = static_cast<uint32_t>(key);
+    if (k < numKeys) {
+        __atomic_fetch_or(&bits[k >> 6], uint64_t(1) << (k & 63), __ATOMIC_RELAXED);
+    }
+}
+
+size_t RuntimeFilter::count() const {
+    size_t total = 0;
+    for (size_t i = 0; i < (numKeys + 63) / 64; ++i) {
+        total += __builtin_popcountll(words[i]);
+    }
+    return total;
+}
+
+size_t RuntimeFilter::memoryBytes() const {
+    return (numKeys + 63) / 64 * sizeof(uint64_t);
+}
+
+const uint64_t* RuntimeFilter::data() const {
+    return words;
+}
+
+uint32_t RuntimeFilter::keyCount() const {
+    return numKeys;
+}
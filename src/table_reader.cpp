@@ -0,0 +1,373 @@
+#include "../include/table_reader.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#ifdef TPCH_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef TPCH_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// Bytes per block handed from the reader thread to the parser
+constexpr size_t kBlockSize = size_t(1) << 20;
+
+// Blocks buffered ahead of the parser
+constexpr size_t kMaxQueuedBlocks = 8;
+
+// Upper bound on threads decompressing zstd frames in parallel
+constexpr unsigned kMaxDecompressThreads = 8;
+
+} // namespace
+
+TableReader::TableReader(const std::string& filePath)
+    : path(filePath), format(Format::Plain), opened(false), fd(-1), done(false), cancelled(false), position(0) {
+    fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    // Detect the format from the magic bytes
+    unsigned char magic[4] = {0, 0, 0, 0};
+    ssize_t magicBytes = pread(fd, magic, sizeof(magic), 0);
+    if (magicBytes >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        format = Format::Gzip;
+    } else if (magicBytes >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        format = Format::Zstd;
+    }
+
+#ifndef TPCH_HAVE_ZLIB
+    if (format == Format::Gzip) {
+        std::cerr << "Error: " << path << " is gzip compressed but this build has no zlib support" << std::endl;
+        return;
+    }
+#endif
+#ifndef TPCH_HAVE_ZSTD
+    if (format == Format::Zstd) {
+        std::cerr << "Error: " << path << " is zstd compressed but this build has no zstd support" << std::endl;
+        return;
+    }
+#endif
+
+    opened = true;
+    producer = std::thread([this] {
+        switch (format) {
+            case Format::Plain: readPlain(); break;
+            case Format::Gzip: readGzip(); break;
+            case Format::Zstd: readZstd(); break;
+        }
+    });
+}
+
+TableReader::~TableReader() {
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        cancelled = true;
+    }
+    notFull.notify_all();
+
+    if (producer.joinable()) {
+        producer.join();
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool TableReader::isOpen() const {
+    return opened;
+}
+
+bool TableReader::readLine(std::string& line) {
+    line.clear();
+
+    while (true) {
+        if (position >= current.size() && !nextBlock()) {
+            return !line.empty();
+        }
+
+        const char* begin = current.data() + position;
+        const char* end = current.data() + current.size();
+        const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+
+        if (newline != nullptr) {
+            line.append(begin, newline);
+            position += (newline - begin) + 1;
+            return true;
+        }
+
+        // The line continues in the next block
+        line.append(begin, end);
+        position = current.size();
+    }
+}
+
+void TableReader::readPlain() {
+    while (true) {
+        Block block(kBlockSize);
+        ssize_t bytesRead = read(fd, block.data(), block.size());
+        if (bytesRead < 0) {
+            finish("read failed");
+            return;
+        }
+        if (bytesRead == 0) {
+            break;
+        }
+
+        block.resize(static_cast<size_t>(bytesRead));
+        if (!pushBlock(std::move(block))) {
+            return;
+        }
+    }
+    finish("");
+}
+
+void TableReader::readGzip() {
+#ifdef TPCH_HAVE_ZLIB
+    // gzdopen takes ownership of the descriptor; concatenated members
+    // (pigz, bgzip) are read transparently
+    gzFile file = gzdopen(fd, "rb");
+    fd = -1;
+    if (file == nullptr) {
+        finish("could not initialize gzip decoder");
+        return;
+    }
+    gzbuffer(file, 256 * 1024);
+
+    std::string error;
+    while (true) {
+        Block block(kBlockSize);
+        int bytesRead = gzread(file, block.data(), static_cast<unsigned>(block.size()));
+        if (bytesRead < 0) {
+            int code = 0;
+            error = gzerror(file, &code);
+            break;
+        }
+        if (bytesRead == 0) {
+            break;
+        }
+
+        block.resize(static_cast<size_t>(bytesRead));
+        if (!pushBlock(std::move(block))) {
+            break;
+        }
+    }
+
+    gzclose(file);
+    finish(error);
+#endif
+}
+
+void TableReader::readZstd() {
+#ifdef TPCH_HAVE_ZSTD
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        finish("stat failed");
+        return;
+    }
+    size_t fileSize = static_cast<size_t>(fileStat.st_size);
+
+    void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        finish("mmap failed");
+        return;
+    }
+    madvise(mapping, fileSize, MADV_SEQUENTIAL);
+    const char* data = static_cast<const char*>(mapping);
+
+    // Locate the frame boundaries
+    std::vector<std::pair<size_t, size_t>> frames;
+    std::string error;
+    for (size_t offset = 0; offset < fileSize;) {
+        size_t frameSize = ZSTD_findFrameCompressedSize(data + offset, fileSize - offset);
+        if (ZSTD_isError(frameSize)) {
+            error = ZSTD_getErrorName(frameSize);
+            break;
+        }
+        frames.emplace_back(offset, frameSize);
+        offset += frameSize;
+    }
+
+    unsigned numWorkers = std::min<unsigned>({std::max(1u, std::thread::hardware_concurrency()),
+                                              kMaxDecompressThreads,
+                                              static_cast<unsigned>(frames.size())});
+
+    if (error.empty() && numWorkers <= 1) {
+        // Stream a single frame in blocks so it is never fully materialized
+        ZSTD_DCtx* context = ZSTD_createDCtx();
+        ZSTD_inBuffer input = {data, fileSize, 0};
+        while (input.pos < input.size) {
+            Block block(kBlockSize);
+            ZSTD_outBuffer output = {block.data(), block.size(), 0};
+            size_t result = ZSTD_decompressStream(context, &output, &input);
+            if (ZSTD_isError(result)) {
+                error = ZSTD_getErrorName(result);
+                break;
+            }
+            block.resize(output.pos);
+            if (!block.empty() && !pushBlock(std::move(block))) {
+                break;
+            }
+        }
+        ZSTD_freeDCtx(context);
+    } else if (error.empty()) {
+        // Workers decompress whole frames within a window ahead of the
+        // delivered frame; this thread hands them to the parser in order
+        std::vector<Block> decoded(frames.size());
+        std::vector<bool> ready(frames.size(), false);
+        std::atomic<size_t> nextFrame(0);
+        size_t delivered = 0;
+        bool failed = false;
+        std::mutex frameMutex;
+        std::condition_variable frameReady;
+        const size_t window = 2 * numWorkers;
+
+        auto worker = [&]() {
+            ZSTD_DCtx* context = ZSTD_createDCtx();
+            while (true) {
+                size_t frame = nextFrame.fetch_add(1);
+                if (frame >= frames.size()) {
+                    break;
+                }
+
+                {
+                    std::unique_lock<std::mutex> lock(frameMutex);
+                    frameReady.wait(lock, [&] { return frame < delivered + window || failed; });
+                    if (failed) {
+                        break;
+                    }
+                }
+
+                const char* source = data + frames[frame].first;
+                size_t sourceSize = frames[frame].second;
+                Block block;
+                std::string frameError;
+
+                unsigned long long contentSize = ZSTD_getFrameContentSize(source, sourceSize);
+                if (contentSize != ZSTD_CONTENTSIZE_UNKNOWN && contentSize != ZSTD_CONTENTSIZE_ERROR) {
+                    block.resize(static_cast<size_t>(contentSize));
+                    size_t result = ZSTD_decompressDCtx(context, block.data(), block.size(), source, sourceSize);
+                    if (ZSTD_isError(result)) {
+                        frameError = ZSTD_getErrorName(result);
+                    } else {
+                        block.resize(result);
+                    }
+                } else {
+                    ZSTD_DCtx_reset(context, ZSTD_reset_session_only);
+                    ZSTD_inBuffer input = {source, sourceSize, 0};
+                    while (input.pos < input.size) {
+                        size_t used = block.size();
+                        block.resize(used + ZSTD_DStreamOutSize());
+                        ZSTD_outBuffer output = {block.data() + used, block.size() - used, 0};
+                        size_t result = ZSTD_decompressStream(context, &output, &input);
+                        block.resize(used + output.pos);
+                        if (ZSTD_isError(result)) {
+                            frameError = ZSTD_getErrorName(result);
+                            break;
+                        }
+                    }
+                }
+
+                std::unique_lock<std::mutex> lock(frameMutex);
+                if (!frameError.empty()) {
+                    if (error.empty()) {
+                        error = frameError;
+                    }
+                    failed = true;
+                } else {
+                    decoded[frame] = std::move(block);
+                    ready[frame] = true;
+                }
+                frameReady.notify_all();
+            }
+            ZSTD_freeDCtx(context);
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < numWorkers; ++i) {
+            workers.emplace_back(worker);
+        }
+
+        for (size_t frame = 0; frame < frames.size(); ++frame) {
+            Block block;
+            {
+                std::unique_lock<std::mutex> lock(frameMutex);
+                frameReady.wait(lock, [&] { return ready[frame] || failed; });
+                if (failed) {
+                    break;
+                }
+                block = std::move(decoded[frame]);
+                delivered = frame + 1;
+            }
+            frameReady.notify_all();
+
+            if (!block.empty() && !pushBlock(std::move(block))) {
+                std::unique_lock<std::mutex> lock(frameMutex);
+                failed = true;
+                frameReady.notify_all();
+                break;
+            }
+        }
+
+        for (auto& thread : workers) {
+            thread.join();
+        }
+    }
+
+    munmap(mapping, fileSize);
+    finish(error);
+#endif
+}
+
+bool TableReader::pushBlock(Block&& block) {
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notFull.wait(lock, [this] { return blocks.size() < kMaxQueuedBlocks || cancelled; });
+        if (cancelled) {
+            return false;
+        }
+        blocks.push_back(std::move(block));
+    }
+    notEmpty.notify_one();
+    return true;
+}
+
+void TableReader::finish(const std::string& error) {
+    if (!error.empty()) {
+        std::cerr << "Error: Failed to read " << path << ": " << error << std::endl;
+    }
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        done = true;
+    }
+    notEmpty.notify_one();
+}
+
+bool TableReader::nextBlock() {
+    if (!opened) {
+        return false;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notEmpty.wait(lock, [this] { return !blocks.empty() || done; });
+        if (blocks.empty()) {
+            return false;
+        }
+        current = std::move(blocks.front());
+        blocks.pop_front();
+    }
+    notFull.notify_one();
+
+    position = 0;
+    return true;
+}